@@ -1,12 +1,43 @@
 #pragma once
+#include "CancelToken.hpp"
 #include "Graph.hpp"
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace graph {
 
+// Per-request parameters, read from the request header lines
+struct AlgorithmParams {
+    std::vector<std::pair<int, int>> flowPairs;// FLOW s t ...: empty = 0 -> n-1
+    bool flowAllPairs = false;// FLOW ALL: the min cut tree
+    bool mstEdges = false;// MST EDGES: the forest's edge list after its weight
+    bool mstComponents = false;// MST COMPONENTS: the number of trees and each vertex's tree
+};
+
 struct Algorithm {
+    // Threads one run may use, 0 = one per core; each stage worker sets its share of the
+    // cores (PipelineConfig::innerThreads), so the stage's replicas don't oversubscribe them
+    unsigned threads = 0;
+
+    // Set by run() when it gave up because cancel fired, so its response is cut short; a
+    // run that completed just as the deadline passed leaves it false
+    bool stopped = false;
+
     virtual ~Algorithm() = default;
     virtual std::string run(const Graph& G) = 0;
+
+    // Algorithms that take parameters, or can give up when cancel fires, override this one
+    virtual std::string run(const Graph& G, const AlgorithmParams&, const CancelToken&) { return run(G); }
+
+    // Whether run() polls its CancelToken at all; a stage time budget only makes sense then
+    virtual bool cancellable() const { return false; }
+
+    // Rough number of steps run() takes on G, used to schedule cheap jobs first (only the
+    // order between jobs matters). The default is linear in the graph size
+    virtual double cost(const Graph& G, const AlgorithmParams&) const {
+        return static_cast<double>(G.get_num_of_vertex()) + static_cast<double>(G.get_num_of_arcs());
+    }
 };
 
 }
@@ -7,11 +7,25 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace graph {
 
 // Factory class for creating algorithm instances
 struct AlgorithmFactory {
+    // Known algorithms in pipeline stage order; bit i of a job's algorithm mask selects NAMES[i]
+    static constexpr const char* NAMES[] = {"MST", "MAXFLOW", "HAMILTON", "MAXCLIQUE"};
+    static constexpr size_t COUNT = 4;
+    static constexpr unsigned ALL = (1u << COUNT) - 1;
+
+    // Position of name in NAMES, -1 if unknown
+    static int index(std::string_view name) {
+        for (size_t i = 0; i < COUNT; ++i) {
+            if (name == NAMES[i]) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
     static std::unique_ptr<Algorithm> create(const std::string& name) {
         if(name == "MST") return std::make_unique<MSTAlgorithm>();
         if(name == "HAMILTON") return std::make_unique<HamiltonAlgorithm>();
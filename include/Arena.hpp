@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/**
+ * Bump allocator for memory that dies all at once: a job's graph, or the scratch space
+ * of one algorithm run. Allocating moves a pointer through the current chunk,
+ * deallocate() does nothing, and everything is given back in one step by rewind(),
+ * release() or the destructor. Chunks come from a recycling pool (see Arena.cpp), so
+ * steady traffic reuses memory that is already mapped instead of faulting in fresh
+ * pages for every request. A locked arena may be shared by threads; an unlocked one
+ * belongs to one thread.
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+    // Position in the arena: rewind(mark) frees what was allocated after it was taken
+    struct Mark {
+        size_t chunk = 0;
+        size_t offset = 0;
+    };
+
+    // Block of memory held by an arena or cached by the pool
+    struct Chunk {
+        char* base;
+        size_t size;
+    };
+
+    explicit Arena(size_t firstChunk = 0, bool locked = false);
+    ~Arena() override;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    Mark mark() const;
+    void rewind(const Mark& m);// keeps the chunks for the next allocations
+    void release();// frees everything and returns the chunks to the pool
+
+    size_t bytesUsed() const;// handed out since the last release, chunk tails included
+    size_t bytesReserved() const;// held in chunks
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    void* bump(size_t bytes, size_t align);
+    void releaseUnlocked();
+
+    std::vector<Chunk> chunks;
+    size_t current = 0;// chunk being filled
+    size_t offset = 0;// first free byte in it
+    const size_t firstChunk;
+    const bool locked;
+    mutable std::mutex m;// only taken when locked
+};
+
+/**
+ * @brief Constructs a T inside an arena. The returned pointer keeps the arena alive, so
+ * the arena (and whatever else was allocated in it) goes away with the last owner of T.
+ */
+template<typename T, typename... Args>
+std::shared_ptr<T> makeInArena(const std::shared_ptr<Arena>& arena, Args&&... args) {
+    T* obj = new (arena->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    return std::shared_ptr<T>(obj, [arena](T* p) { p->~T(); });
+}
+
+/**
+ * Opens a scratch region on this thread's arena: until the scope closes, scratch() hands
+ * out memory that the destructor frees in one step. Scopes nest; an inner scope must not
+ * grow containers that belong to an outer one, as that memory would be freed with it.
+ */
+class ScratchScope {
+public:
+    ScratchScope();
+    ~ScratchScope();
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+private:
+    Arena::Mark mark;
+};
+
+// Memory resource for algorithm temporaries: this thread's arena inside a ScratchScope,
+// the global heap outside one
+std::pmr::memory_resource* scratch();
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace graph {
+
+/**
+ * BGRAPH binary upload format, an alternative to the text GRAPH request. All integers
+ * are little-endian:
+ *
+ *   "BGRAPH"   6 bytes, at the very start of the request
+ *   u8         version (1)
+ *   u8         encoding: 0 = raw records, 1 = sorted delta/varint records
+ *   u32        V
+ *   u32        E
+ *   E edge records
+ *
+ * Raw record: u32 src, u32 dst, i32 weight (12 bytes).
+ * Varint record, edges sorted by (src, dst): LEB128 varints of the src delta, of the
+ * dst (delta to the previous dst while src stays the same, absolute otherwise) and of
+ * the zigzag-encoded weight. Typical graphs shrink to 3-5 bytes per edge.
+ */
+namespace bgraph {
+
+constexpr char MAGIC[] = "BGRAPH";
+constexpr size_t MAGIC_SIZE = 6;
+constexpr uint8_t VERSION = 1;
+enum Encoding : uint8_t { RAW = 0, VARINT = 1 };
+
+constexpr size_t HEADER_SIZE = MAGIC_SIZE + 2 + 4 + 4;
+constexpr size_t RAW_RECORD_SIZE = 12;
+constexpr size_t MAX_VARINT_RECORD = 15;// three varints of at most 5 bytes
+
+struct Edge {
+    uint32_t src, dst;
+    int32_t weight;
+};
+
+// Builds a complete BGRAPH request; VARINT sorts (a copy of) the edges first
+std::string encode(uint32_t V, std::vector<Edge> edges, Encoding encoding);
+
+inline uint32_t loadU32(const unsigned char* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+/**
+ * Reads one LEB128 varint of at most 5 bytes from [p, end).
+ * @return The byte after the varint, or nullptr if the input ends first or (bad set)
+ * the varint is longer than a u32 allows.
+ */
+inline const unsigned char* readVarint(const unsigned char* p, const unsigned char* end,
+                                       uint32_t& out, bool& bad) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) return nullptr;
+        unsigned char byte = *p++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            if (value > UINT32_MAX) break;
+            out = static_cast<uint32_t>(value);
+            return p;
+        }
+    }
+    bad = true;
+    return nullptr;
+}
+
+inline int32_t unzigzag(uint32_t z) {
+    return static_cast<int32_t>((z >> 1) ^ (~(z & 1) + 1));
+}
+
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace graph {
+
+/**
+ * What a running algorithm polls to give up early: the job's cancel flag (set when its
+ * client is gone) and a deadline (the job's, or the stage's time budget if that ends
+ * first). stopRequested() reads the clock; search loops poll through a CancelPoll.
+ */
+class CancelToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancelToken() = default;// never stops
+    CancelToken(const std::atomic<bool>* flag, Clock::time_point deadline) : flag(flag), deadline(deadline) {}
+
+    bool cancelled() const { return flag && flag->load(std::memory_order_relaxed); }
+    bool expired() const { return deadline != Clock::time_point::max() && Clock::now() >= deadline; }
+    bool stopRequested() const { return cancelled() || expired(); }
+
+private:
+    const std::atomic<bool>* flag = nullptr;
+    Clock::time_point deadline = Clock::time_point::max();
+};
+
+// Cheap check for hot loops: asks the token only every INTERVAL calls, and stays stopped once it said so
+class CancelPoll {
+    static constexpr uint32_t INTERVAL = 1024;
+    const CancelToken* token;
+    uint32_t left = INTERVAL;
+    bool stopped = false;
+
+public:
+    explicit CancelPoll(const CancelToken* token) : token(token) {}
+
+    bool operator()() {
+        if (stopped) return true;
+        if (!token || --left) return false;
+        left = INTERVAL;
+        stopped = token->stopRequested();
+        return stopped;
+    }
+};
+
+}
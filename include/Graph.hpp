@@ -6,11 +6,15 @@
 #include <stdexcept>
 #include <iostream>
 #include <functional>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 
 // Forward declarations
 namespace graph {
     class Graph;
 }
+class MaxFlow;
 long long mst_weight_kruskal(const graph::Graph& G);
 
 namespace graph {
@@ -22,19 +26,67 @@ public:
         int dest;
         int weight; // for unweighted graphs, keep as 1
     };
+
+    // Read-only view over a contiguous run of edges (C++17 stand-in for std::span)
+    class EdgeSpan {
+        const Edge* first;
+        const Edge* last;
+    public:
+        EdgeSpan(const Edge* f, const Edge* l) : first(f), last(l) {}
+        const Edge* begin() const { return first; }
+        const Edge* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+        const Edge& operator[](size_t i) const { return first[i]; }
+    };
+
 private:
     int num_of_vertex;
-    std::vector<std::vector<Edge>> adj_list; // adjacency list representation
+    std::vector<std::vector<Edge>> adj_list; // adjacency list representation (while building)
+
+    // Where the frozen arrays and the flow network live, e.g. the job's arena (see Arena.hpp)
+    std::pmr::memory_resource* resource;
+
+    // Compressed sparse row form, filled by freeze():
+    // the edges of vertex v are csr_edges[csr_offsets[v] .. csr_offsets[v+1])
+    bool frozen = false;
+    std::pmr::vector<size_t> csr_offsets;
+    std::pmr::vector<Edge> csr_edges;
+
+    // Adjacency index picked by freeze(): a bit matrix for small or dense graphs
+    // (row v is adj_bits[v*row_words .. (v+1)*row_words)), otherwise the CSR
+    // lists are sorted by dest and searched with binary search
+    std::pmr::vector<uint64_t> adj_bits;
+    size_t row_words = 0;
+
+    // Residual network for max_flow(), built on the first call after freeze() and reused
+    mutable std::shared_ptr<const MaxFlow> flow_net;
 
 public:
 
-    explicit Graph(int num_ver);//constructor
+    explicit Graph(int num_ver, std::pmr::memory_resource* mr = std::pmr::get_default_resource());//constructor
    
     //declaration of all the function we used in Graph.cpp
     void addEdge(int src, int dest, int weight = 1);
 
+    // One edge of a bulk load
+    struct EdgeRecord {
+        int src;
+        int dest;
+        int weight;
+    };
+
+    // Builds the frozen (CSR) form straight from an edge array, as addEdge() on every record
+    // followed by freeze() would. Large arrays are counted, prefix-summed and scattered by
+    // `threads` workers (0 = one per core); the lists then come out sorted by neighbour
+    // instead of in record order. The graph must have no edges yet
+    void bulkLoad(const std::vector<EdgeRecord>& edges, unsigned threads = 0);
+
     int get_num_of_vertex() const;
 
+    // Adjacency entries: 2E for E undirected edges (a self-loop is stored once)
+    size_t get_num_of_arcs() const;
+
     std::vector<std::tuple<int,int,int>> get_edges() const;
 
     //for algserver:
@@ -45,13 +97,43 @@ public:
         return std::vector<int>{};
     }
 
-    int max_flow(int a, int b) const;
+    long long max_flow(int a, int b) const;
+
+    // Max flow from a to b plus a minimum cut: source_side[v] is 1 on a's side
+    long long min_cut(int a, int b, std::vector<char>& source_side) const;
 
     // Get neighbors of a vertex
-    const std::vector<Edge>& neighbors(int v) const;
+    EdgeSpan neighbors(int v) const;
+
+    // Packs the adjacency lists into CSR form; the graph is immutable afterwards
+    void freeze();
+
+    // Adjacency test: O(1) with the bit matrix, O(log deg) on sorted CSR lists,
+    // linear scan of the shorter list before freeze()
+    bool has_edge(int u, int v) const;
+
+    // Row of the bit matrix for v (bit w set iff u~w), or nullptr if the graph has none
+    const uint64_t* adjacency_row(int v) const;
+    size_t adjacency_row_words() const { return row_words; }
+
+    bool is_frozen() const { return frozen; }
+
+    // Approximate heap footprint of the current layout, in bytes
+    size_t memory_bytes() const;
+
+    // Footprint of the frozen form of a graph with n vertices and `arcs` adjacency entries,
+    // e.g. to size an arena before building it
+    static size_t frozen_bytes(int n, size_t arcs);
 
 private:
+    // Limits for choosing the bit matrix in buildAdjacencyIndex()
+    static constexpr size_t MATRIX_MAX_VERTICES = 4096;// at most 2 MB of bits
+    static constexpr size_t MATRIX_EDGE_RATIO = 4;// or no more than 4x the edge array
+    static constexpr size_t BULK_PARALLEL_MIN_EDGES = size_t(1) << 16;// smaller bulk loads stay on one thread
+
     void validVertex(int v) const;
+    void buildAdjacencyIndex(unsigned threads = 1);
+    std::shared_ptr<const MaxFlow> flowNetwork() const;
 };
 
 } 
@@ -0,0 +1,210 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace graph {
+
+/**
+ * Bounded lock-free multi-producer/multi-consumer ring (Dmitry Vyukov's design):
+ * every cell carries a sequence number that tells producers and consumers whose turn it
+ * is, so push and pop are one CAS on a position counter plus one store, no lock.
+ *
+ * Blocking calls spin for a short while and then park on a condition variable; the
+ * mutex is only touched when somebody is actually parked. Same push/pop/try_pop/close
+ * API as BlockingQueue, except that push() waits while the ring is full.
+ */
+template<typename T>
+class MPMCQueue {
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    static constexpr int SPIN_LIMIT = 128;// failed attempts before parking
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+    alignas(64) std::atomic<bool> is_closed{false};
+
+    // Parking for consumers (queue empty) and producers (queue full)
+    std::mutex park_mutex;
+    std::condition_variable not_empty, not_full;
+    std::atomic<int> waiting_consumers{0}, waiting_producers{0};
+
+    static size_t roundUp(size_t n) {
+        size_t c = 2;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+    void wake(std::condition_variable& cv, std::atomic<int>& waiters) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);// pairs with the waiter's increment
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lk(park_mutex);
+            cv.notify_all();
+        }
+    }
+
+    bool tryEnqueue(T& item) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(item);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;// full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryDequeue(T& item) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.data);
+                    cell.data = T{};
+                    cell.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;// empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Spin, then park until op() succeeds, the queue is closed, or the deadline passes
+    template<typename Op>
+    bool waitFor(Op op, std::condition_variable& cv, std::atomic<int>& waiters,
+                 std::chrono::steady_clock::time_point deadline) {
+        for (int i = 0; i < SPIN_LIMIT; ++i) {
+            if (op()) return true;
+            if (is_closed.load(std::memory_order_acquire)) return false;
+            if (i > SPIN_LIMIT / 2) std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lk(park_mutex);
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);// pairs with the fence in wake()
+        bool ok = false;
+        while (!(ok = op()) && !is_closed.load(std::memory_order_acquire)) {
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                cv.wait(lk);
+            } else if (cv.wait_until(lk, deadline) == std::cv_status::timeout) {
+                ok = op();
+                break;
+            }
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return ok;
+    }
+
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;// used for capacity 0: the ring is always bounded
+
+    explicit MPMCQueue(size_t capacity = DEFAULT_CAPACITY)
+        : mask(roundUp(capacity ? capacity : DEFAULT_CAPACITY) - 1), cells(new Cell[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    //function to push items into the queue, waits while it is full
+    void push(T item) {
+        if (is_closed.load(std::memory_order_acquire)) return;//check if closed
+        auto forever = std::chrono::steady_clock::time_point::max();
+        if (!waitFor([&]{ return tryEnqueue(item); }, not_full, waiting_producers, forever)) return;
+        wake(not_empty, waiting_consumers);
+    }
+
+    // Pushes only if there is room right now
+    bool try_push(T& item) {
+        if (is_closed.load(std::memory_order_acquire) || !tryEnqueue(item)) return false;
+        wake(not_empty, waiting_consumers);
+        return true;
+    }
+
+    // Pushes without waiting; if the ring is full the oldest item is dropped into `shed`.
+    // Returns true if an item was shed
+    bool push_shed_oldest(T item, T& shed) {
+        if (is_closed.load(std::memory_order_acquire)) return false;
+        bool dropped = false;
+        while (!tryEnqueue(item)) {
+            if (dropped) {// another producer took the freed cell: wait like push()
+                push(std::move(item));
+                return true;
+            }
+            dropped = tryDequeue(shed);
+        }
+        wake(not_empty, waiting_consumers);
+        return dropped;
+    }
+
+    //function to pop items from the queue; returns an empty T once closed and drained
+    T pop() {
+        T item{};
+        auto forever = std::chrono::steady_clock::time_point::max();
+        if (waitFor([&]{ return tryDequeue(item); }, not_empty, waiting_consumers, forever)) {
+            wake(not_full, waiting_producers);
+            return item;
+        }
+        tryDequeue(item);// closed: still hand out what is left
+        return item;
+    }
+
+    // Like pop() but gives up after timeout; returns false on timeout or when closed and empty
+    bool pop_for(T& item, std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        bool ok = waitFor([&]{ return tryDequeue(item); }, not_empty, waiting_consumers, deadline)
+                  || tryDequeue(item);
+        if (ok) wake(not_full, waiting_producers);
+        return ok;
+    }
+
+    bool try_pop(T& item) {
+        if (!tryDequeue(item)) return false;
+        wake(not_full, waiting_producers);
+        return true;
+    }
+
+    void close() {
+        is_closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lk(park_mutex);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    bool closed() const { return is_closed.load(std::memory_order_acquire); }
+
+    // Approximate under concurrent use
+    size_t size() const {
+        size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+};
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "AlgorithmFactory.hpp"
+#include "ResultCache.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/**
+ * Latency histogram in the HDR style: values below SUB_COUNT microseconds get a bucket
+ * each, every power of two above is split into SUB_COUNT linear sub-buckets, so any
+ * recorded value keeps about 3% relative precision up to 2^MAX_EXP us (~12 days).
+ * Written by one thread only (see MetricsShard): record() is a few relaxed loads and
+ * stores, no lock and no read-modify-write. Readers copy it with HistogramSnapshot::add.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = 1u << SUB_BITS;
+    static constexpr unsigned MAX_EXP = 39;// larger values land in the last bucket
+    static constexpr size_t BUCKETS = (MAX_EXP - SUB_BITS + 2) * SUB_COUNT;
+
+    // Bucket of a value in microseconds
+    static size_t bucketOf(uint64_t us);
+    // Largest value that falls into bucket b
+    static uint64_t bucketHigh(size_t b);
+
+    void record(uint64_t us);
+
+private:
+    friend struct HistogramSnapshot;
+    std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+    std::atomic<uint64_t> total{0}, sum{0}, max{0};
+};
+
+// A point-in-time copy of one or more histograms added up
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts = std::vector<uint64_t>(LatencyHistogram::BUCKETS, 0);
+    uint64_t total = 0, sum = 0, max = 0;
+
+    void add(const LatencyHistogram& h);
+    // Smallest bucket bound with at least fraction q of the values at or below it, 0 if empty
+    uint64_t percentile(double q) const;
+    // Values recorded at or below us; exact only at a bucket's upper edge (bucketHigh)
+    uint64_t countAtMost(uint64_t us) const;
+};
+
+/**
+ * What one thread has recorded. Only its owner writes, so every field is a plain
+ * relaxed atomic that readers may load at any time without tearing.
+ */
+struct MetricsShard {
+    struct Stage {
+        LatencyHistogram wait;// time in the stage's queue
+        LatencyHistogram run;// time inside Algorithm::run
+        std::atomic<uint64_t> runs{0};// jobs the stage ran (or refused to run, see below)
+        std::atomic<uint64_t> timeouts{0};// deadline or budget hit, before or while running
+        std::atomic<uint64_t> cancelled{0};// client gone, before or while running
+    };
+    std::array<Stage, AlgorithmFactory::COUNT> stages;
+    LatencyHistogram endToEnd;// from parse to response, cache hits included
+    std::atomic<uint64_t> completed{0};// jobs answered, any outcome
+    std::atomic<uint64_t> rejected{0};// refused by the admission policy (ERR BUSY)
+};
+
+// Everything recorded so far, summed over the threads
+struct MetricsSnapshot {
+    struct Stage {
+        HistogramSnapshot wait, run;
+        uint64_t runs = 0, timeouts = 0, cancelled = 0;
+    };
+    std::array<Stage, AlgorithmFactory::COUNT> stages;
+    HistogramSnapshot endToEnd;
+    uint64_t completed = 0, rejected = 0;
+    int64_t connections = 0;
+    double uptimeSeconds = 0;
+};
+
+/**
+ * Process-wide metrics. Every thread that records gets its own MetricsShard on first use
+ * (one mutex acquisition per thread lifetime); when the thread exits its shard goes to a
+ * free list and the next new thread continues it, so the totals never drop and elastic
+ * workers coming and going do not grow the registry.
+ */
+class Metrics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Metrics& instance();
+
+    void recordWait(size_t stage, Clock::duration waited);
+    void recordRun(size_t stage, Clock::duration ran, bool timedOut, bool cancelled);
+    void recordNotRun(size_t stage, bool timedOut, bool cancelled);// stopped while queued
+    void recordCompleted(Clock::duration endToEnd);
+    void recordRejected();
+
+    // Open client connections, from the reactors and the thread-per-connection server
+    void connectionOpened() { connections.fetch_add(1, std::memory_order_relaxed); }
+    void connectionClosed() { connections.fetch_sub(1, std::memory_order_relaxed); }
+
+    MetricsSnapshot snapshot() const;
+
+private:
+    Metrics() = default;
+    MetricsShard& local();
+    friend struct ShardLease;
+    void release(MetricsShard* shard);
+
+    mutable std::mutex m;// guards the registry only, never taken while recording
+    std::vector<std::unique_ptr<MetricsShard>> shards;
+    std::vector<MetricsShard*> spare;// shards of exited threads
+    std::atomic<int64_t> connections{0};
+    Clock::time_point started = Clock::now();
+};
+
+using QueueDepths = std::vector<std::pair<std::string, size_t>>;
+
+// STATS reply: one line per stage plus the end-to-end latencies, queue depths and cache counters
+std::string formatStats(const MetricsSnapshot& s, const QueueDepths& depths, const ResultCache::Counters& cache);
+
+// STATS PROMETHEUS reply: the same numbers in the Prometheus text exposition format
+std::string formatPrometheus(const MetricsSnapshot& s, const QueueDepths& depths, const ResultCache::Counters& cache);
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace graph {
+
+// Worker count for a parallel loop: 0 means one per core
+inline unsigned resolveThreads(unsigned threads) {
+    return threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs body(0..count-1) on up to `threads` workers; inline when one is enough. The first
+// exception a body throws stops the loop and is rethrown here once the workers are joined
+template<typename F>
+void parallelFor(size_t count, unsigned threads, F&& body) {
+    threads = static_cast<unsigned>(std::min<size_t>(threads, count));
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto work = [&] {
+        try {
+            for (size_t i; (i = next.fetch_add(1)) < count;) body(i);
+        } catch (...) {// escaping a std::thread would terminate the process
+            std::lock_guard<std::mutex> lk(errorMutex);
+            if (!error) error = std::current_exception();
+            next.store(count);
+        }
+    };
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned t = 0; t < threads; ++t) workers.emplace_back(work);
+    } catch (const std::system_error&) {// out of threads: the ones started share the loop
+        if (workers.empty()) work();
+    }
+    for (auto& w : workers) w.join();
+    if (error) std::rethrow_exception(error);
+}
+
+// Splits [0, count) into `blocks` contiguous ranges and runs body(block, begin, end) for each
+template<typename F>
+void parallelBlocks(size_t count, size_t blocks, unsigned threads, F&& body) {
+    blocks = std::max<size_t>(1, std::min(blocks, count));
+    parallelFor(blocks, threads, [&](size_t b) {
+        body(b, count * b / blocks, count * (b + 1) / blocks);
+    });
+}
+
+}
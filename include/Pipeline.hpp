@@ -2,13 +2,21 @@
 #pragma once
 #include "Graph.hpp"
 #include "AlgorithmFactory.hpp"
+#include "MPMCQueue.hpp"
+#include "ResultCache.hpp"
+#include <array>
 #include <queue>
+#include <set>
 #include <mutex>
 #include <condition_variable>
 #include <memory>
 #include <thread>
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <map>
+#include <functional>
+#include <vector>
 
 namespace graph {
     extern std::mutex cout_mutex;// mutex for console output
@@ -16,12 +24,47 @@ namespace graph {
 
 struct Job {
     //define job
-    std::shared_ptr<Graph> g;
+    std::shared_ptr<const Graph> g;// frozen (CSR) graph shared read-only by all stages; it lives in the job's arena, freed in one go with it
     std::string result;
     std::atomic<bool> completed{false}; // flag to indicate if job is completed
+    unsigned algorithms = AlgorithmFactory::ALL;// stages to run (ALGS), bit i = AlgorithmFactory::NAMES[i]
+    AlgorithmParams params;// e.g. the FLOW pairs
+
+    // Time limits and cancellation: stages poll a CancelToken over these (see stageWorker)
+    std::chrono::milliseconds timeout{0};// TIMEOUT line, 0 = the server's jobTimeout
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();// set by pushJob
+    std::atomic<bool> cancelled{false};// the client is gone (ThreadPool::cancelJob)
+    bool stopped_early = false;// some stage gave up, so the response must not be cached (under job_mutex)
+
+    // A job is answered once: by the sink, or by the deadline watch (ThreadPool::expireWorker)
+    // if its deadline passes while it waits in a queue. Stages drop a job that was answered
+    std::atomic<bool> answered{false};
+    int running = 0;// stages working on the job right now (under job_mutex)
+    unsigned stages_done = 0;// bit i: stage i has added its part (under job_mutex)
+
+    bool wants(size_t stage) const { return (algorithms >> stage) & 1u; }
+
+    // For the latency metrics
+    std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();// parsed
+    std::chrono::steady_clock::time_point queued_at;// entered its current stage queue
+
+    // Estimated work per stage (Algorithm::cost), set by pushJob; the stage queues serve the cheapest first
+    std::array<double, AlgorithmFactory::COUNT> cost{};
+
+    // Fan-out mode: each stage writes its own slot, the sink joins them in stage order
+    std::vector<std::string> parts;
+    size_t parts_done = 0;// touched by the sink only
+    size_t parts_expected = 0;// requested stages, set by pushJob
 
     mutable std::mutex job_mutex; // mutex to protect access to job data
     std::condition_variable cv; // condition variable for job completion
+    std::function<void()> on_complete;// optional, set before pushJob: called once after cv is notified, outside job_mutex
+
+    // Result cache: set by pushJob when this job runs for its graph; others may coalesce onto
+    // it only if neither has a deadline
+    bool cache_leader = false;
+    CacheKey cache_key;
+    bool solo = false;// a follower run again on its own after its leader stopped early
 
     static std::atomic<size_t> next_id;// for unique job identification
     size_t id;
@@ -37,31 +80,77 @@ class BlockingQueue {
     std::queue<T> q;//queue to hold items
     mutable std::mutex m;//to protect access to the queue
     std::condition_variable cv;// condition variable for queue operations
+    std::condition_variable not_full;// producers waiting for room (bounded queues only)
     bool is_closed = false;//renamed to avoid conflict
+    size_t cap;// 0 = unbounded
+
+    bool full() const { return cap != 0 && q.size() >= cap; }
+
+    T take() {
+        T item = std::move(q.front());//create item that is moved from the front of the queue
+        q.pop();
+        if (cap != 0) not_full.notify_one();
+        return item;
+    }
 public:
-    //function to push items into the queue
+    explicit BlockingQueue(size_t capacity = 0) : cap(capacity) {}
+
+    //function to push items into the queue, waits while a bounded queue is full
     void push(T item) {
         std::unique_lock<std::mutex> lk(m);
+        not_full.wait(lk, [&]{ return !full() || is_closed; });
         if(is_closed) return;//check if closed
         q.push(std::move(item));
         cv.notify_one();// notify one waiting thread
     }
+
+    // Pushes only if there is room right now
+    bool try_push(T& item) {
+        std::unique_lock<std::mutex> lk(m);
+        if (is_closed || full()) return false;
+        q.push(std::move(item));
+        cv.notify_one();
+        return true;
+    }
+
+    // Pushes without waiting; if the queue is full the oldest item is dropped into `shed`.
+    // Returns true if an item was shed
+    bool push_shed_oldest(T item, T& shed) {
+        std::unique_lock<std::mutex> lk(m);
+        if (is_closed) return false;
+        bool dropped = false;
+        if (full()) {
+            shed = std::move(q.front());
+            q.pop();
+            dropped = true;
+        }
+        q.push(std::move(item));
+        cv.notify_one();
+        return dropped;
+    }
+
     //function to pop items from the queue
     T pop() {
         std::unique_lock<std::mutex> lk(m);//to protect access to the queue
         cv.wait(lk, [&]{ return !q.empty() || is_closed; });//wait until queue not empty or closed
 
         if(q.empty()) return nullptr;//return null if empty and closed
-        T item = std::move(q.front());//create item that is moved from the front of the queue
-        q.pop();
-        return item;
+        return take();
+    }
+
+    // Like pop() but gives up after timeout; returns false on timeout or when closed and empty
+    bool pop_for(T& item, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lk(m);
+        if (!cv.wait_for(lk, timeout, [&]{ return !q.empty() || is_closed; })) return false;
+        if (q.empty()) return false;
+        item = take();
+        return true;
     }
 
     bool try_pop(T& item) {
         std::unique_lock<std::mutex> lk(m);
         if (q.empty()) return false;
-        item = std::move(q.front());
-        q.pop();
+        item = take();
         return true;
     }
 
@@ -69,14 +158,217 @@ public:
         std::unique_lock<std::mutex> lk(m);
         is_closed = true;
         cv.notify_all();
+        not_full.notify_all();
+    }
+
+    bool closed() const {
+        std::unique_lock<std::mutex> lk(m);
+        return is_closed;
+    }
+
+    size_t size() const {
+        std::unique_lock<std::mutex> lk(m);
+        return q.size();
+    }
+
+    size_t capacity() const { return cap; }
+};
+
+// Job queue that serves the job with the smallest estimated cost for its stage first
+// (shortest expected job first), so small graphs do not wait behind bulk uploads.
+// Against starvation, the oldest job goes first once maxOvertakes later jobs have been
+// served before it. Until order() is called it is a plain FIFO.
+// Same API as BlockingQueue; push_shed_oldest() sheds the job that arrived first
+class SchedulingQueue {
+    struct Entry {
+        JobPtr job;
+        double cost;
+        uint64_t due;// value of `removed` at which FIFO order would serve this job
+    };
+    using Arrivals = std::map<uint64_t, Entry>;
+
+    Arrivals arrivals;// by arrival number: begin() is the oldest
+    std::set<std::pair<double, uint64_t>> byCost;// (cost, arrival number): begin() is the cheapest
+    uint64_t next_seq = 0;
+    uint64_t removed = 0;// jobs taken out so far
+    mutable std::mutex m;
+    std::condition_variable cv;
+    std::condition_variable not_full;
+    bool is_closed = false;
+    size_t cap;// 0 = unbounded
+    int stage = -1;// index into Job::cost, -1 = FIFO
+    size_t maxOvertakes = 0;
+
+    bool full() const { return cap != 0 && arrivals.size() >= cap; }
+
+    void put(JobPtr job) {
+        double cost = stage >= 0 ? job->cost[stage] : 0.0;
+        uint64_t seq = next_seq++;
+        byCost.emplace(cost, seq);
+        arrivals.emplace(seq, Entry{std::move(job), cost, removed + arrivals.size()});
+        cv.notify_one();
+    }
+
+    JobPtr remove(Arrivals::iterator it) {
+        JobPtr job = std::move(it->second.job);
+        byCost.erase({it->second.cost, it->first});
+        arrivals.erase(it);
+        ++removed;
+        if (cap != 0) not_full.notify_one();
+        return job;
+    }
+
+    JobPtr take() {
+        auto oldest = arrivals.begin();
+        if (stage < 0 || removed >= oldest->second.due + maxOvertakes) return remove(oldest);// overtaken enough
+        return remove(arrivals.find(byCost.begin()->second));
+    }
+public:
+    explicit SchedulingQueue(size_t capacity = 0) : cap(capacity) {}
+
+    // Orders by job->cost[costIndex] from now on, letting at most `overtakes` jobs pass a waiting one
+    void order(size_t costIndex, size_t overtakes) {
+        std::unique_lock<std::mutex> lk(m);
+        stage = static_cast<int>(costIndex);
+        maxOvertakes = overtakes;
+    }
+
+    void push(JobPtr item) {
+        std::unique_lock<std::mutex> lk(m);
+        not_full.wait(lk, [&]{ return !full() || is_closed; });
+        if (is_closed) return;
+        put(std::move(item));
+    }
+
+    bool try_push(JobPtr& item) {
+        std::unique_lock<std::mutex> lk(m);
+        if (is_closed || full()) return false;
+        put(std::move(item));
+        return true;
+    }
+
+    bool push_shed_oldest(JobPtr item, JobPtr& shed) {
+        std::unique_lock<std::mutex> lk(m);
+        if (is_closed) return false;
+        bool dropped = false;
+        if (full()) {
+            shed = remove(arrivals.begin());
+            dropped = true;
+        }
+        put(std::move(item));
+        return dropped;
+    }
+
+    JobPtr pop() {
+        std::unique_lock<std::mutex> lk(m);
+        cv.wait(lk, [&]{ return !arrivals.empty() || is_closed; });
+        if (arrivals.empty()) return nullptr;
+        return take();
+    }
+
+    bool pop_for(JobPtr& item, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lk(m);
+        if (!cv.wait_for(lk, timeout, [&]{ return !arrivals.empty() || is_closed; })) return false;
+        if (arrivals.empty()) return false;
+        item = take();
+        return true;
+    }
+
+    bool try_pop(JobPtr& item) {
+        std::unique_lock<std::mutex> lk(m);
+        if (arrivals.empty()) return false;
+        item = take();
+        return true;
+    }
+
+    void close() {
+        std::unique_lock<std::mutex> lk(m);
+        is_closed = true;
+        cv.notify_all();
+        not_full.notify_all();
     }
+
+    bool closed() const {
+        std::unique_lock<std::mutex> lk(m);
+        return is_closed;
+    }
+
+    size_t size() const {
+        std::unique_lock<std::mutex> lk(m);
+        return arrivals.size();
+    }
+
+    size_t capacity() const { return cap; }
+};
+
+// Queue type between the pipeline stages: the lock-free ring when built with
+// -DPIPELINE_LOCKFREE_QUEUE (make LOCKFREE_QUEUE=1), the cost-ordered mutex queue otherwise
+#ifdef PIPELINE_LOCKFREE_QUEUE
+using JobQueue = MPMCQueue<JobPtr>;
+#else
+using JobQueue = SchedulingQueue;
+#endif
+
+// Order in which a stage takes the jobs waiting for it
+enum class Scheduling {
+    Fifo,          // arrival order
+    ShortestFirst  // smallest estimated cost first, with maxOvertakes against starvation
+};
+
+// What pushJob() does when the pipeline's entry queue is full
+enum class AdmissionPolicy {
+    Block,      // the client thread waits for room
+    Reject,     // the new job is refused (ERR BUSY)
+    ShedOldest  // the oldest queued job is answered ERR BUSY to make room
+};
+
+// Worker counts and queue limits for the pipeline stages; set through
+// ThreadPool::configure() before the first ThreadPool::instance() call
+struct PipelineConfig {
+    unsigned workersPerStage = 1;// workers started for every stage
+    std::map<std::string, unsigned> stageWorkers;// per-stage override, e.g. {"MAXCLIQUE", 4}
+    unsigned maxWorkersPerStage = 0;// above the start count enables auto-scaling up to this many
+    unsigned innerThreads = 0;// threads one run may use inside a stage, 0 = the cores split among the stage's most workers
+    size_t backlogPerWorker = 4;// queued jobs per worker that make the monitor add a worker
+    std::chrono::milliseconds idleTimeout{2000};// extra workers idle this long exit again
+    bool fanOut = false;// run all four stages on a job at once instead of one after another
+    size_t queueCapacity = 0;// jobs per queue, 0 = unbounded (the lock-free ring defaults to 1024)
+    AdmissionPolicy admission = AdmissionPolicy::Block;// applied where jobs enter; inner queues always block
+    size_t cacheBytes = 32u << 20;// result cache budget: responses and the edge lists they answer, 0 = no cache
+    std::chrono::milliseconds jobTimeout{0};// deadline for a whole job from pushJob on, 0 = none
+    std::map<std::string, std::chrono::milliseconds> stageBudgets;// per-algorithm run time limit, e.g. {"HAMILTON", 2s}
+    Scheduling scheduling = Scheduling::ShortestFirst;// needs the mutex queues, the lock-free ring is always FIFO
+    size_t maxOvertakes = 16;// cheaper jobs that may pass a queued job before it goes first
 };
 
 //create class ThreadPool
 class ThreadPool {
 public:
-    //function to push jobs into the input queue
-    void pushJob(JobPtr job);
+    //function to push jobs into the input queue; false if the admission policy refused it.
+    //A cached or already running graph completes the job without entering the queue
+    bool pushJob(JobPtr job);
+
+    // What offerJob() did with a job
+    enum class Offer {
+        Queued,   // in the pipeline, or answered or joined by the result cache
+        Rejected, // refused by the admission policy (ERR BUSY)
+        Full      // AdmissionPolicy::Block with no room: hand it to retryJob() later
+    };
+
+    // pushJob() for event loops, which must never wait for room
+    Offer offerJob(JobPtr job);
+    // Another attempt for a job offerJob() returned Full; Queued or Full
+    Offer retryJob(const JobPtr& job);
+    // Calls wake once, from a pipeline thread, the next time a job leaves an entry queue
+    void notifyWhenRoom(std::function<void()> wake);
+
+    // Jobs waiting in front of each stage and the sink, as (name, depth) pairs
+    std::vector<std::pair<std::string, size_t>> queueDepths() const;
+    size_t queueCapacity() const { return config().queueCapacity; }
+    ResultCache::Counters cacheCounters() const { return cache.counters(); }
+
+    // The job's client is gone: its stages give up, unless identical jobs wait for its result
+    void cancelJob(const JobPtr& job);
 
     // Singleton accessor
     static ThreadPool& instance() {
@@ -84,6 +376,9 @@ public:
         return pool;
     }
 
+    // Must be called before the first instance() call to take effect
+    static void configure(const PipelineConfig& cfg) { config() = cfg; }
+
     void shutdown() {
         server_running.store(false);
         q_in.close();
@@ -97,11 +392,65 @@ public:
     ~ThreadPool() = default;
 
 private:
+    // One algorithm stage: its queues and how many workers currently serve it
+    struct Stage {
+        std::string name;
+        size_t index;// position in the canonical response order
+        JobQueue* in;
+        JobQueue* out;
+        unsigned minWorkers, maxWorkers;
+        unsigned innerThreads = 1;// for each run (Algorithm::threads): workers x innerThreads <= cores
+        std::chrono::milliseconds budget{0};// run time limit per job, 0 = none
+        std::unique_ptr<Algorithm> model;// for Algorithm::cost() estimates in pushJob
+        std::atomic<unsigned> workers{0};
+    };
+
     ThreadPool(); // private constructor
-    void stageWorker(const std::string& algName, BlockingQueue<JobPtr>& in, BlockingQueue<JobPtr>& out);
-    void sinkWorker(BlockingQueue<JobPtr>& in);
+    static PipelineConfig& config() {
+        static PipelineConfig cfg;
+        return cfg;
+    }
+    void startWorker(Stage& stage, bool elastic);
+    void stageWorker(Stage& stage, bool elastic);
+    void sinkWorker(JobQueue& in);
+    void monitorWorker();
+    void expireWorker();
+    void watchDeadline(const JobPtr& job);
+    bool expireJob(const JobPtr& job);
+    bool submit(JobPtr job, AdmissionPolicy policy);
+    bool prepare(const JobPtr& job);
+    bool enter(JobPtr job, AdmissionPolicy policy);
+    void refuse(const JobPtr& job);
+    void wakeRoomWaiters();
+    void resubmit(const JobPtr& job);
+    bool admit(JobPtr& job, AdmissionPolicy policy);
+    void finishJob(const JobPtr& job, bool cacheable);
+    void failJob(const JobPtr& job, const std::string& message);
+    static void completeJob(const JobPtr& job);
+
+    // Input queues of MST, MAXFLOW, HAMILTON, MAXCLIQUE and the sink. In serial mode each
+    // stage feeds the next; in fan-out mode pushJob() feeds all four and they all feed the sink
+    JobQueue q_in, q_mst, q_maxflow, q_ham, q_clique;
+    std::vector<std::unique_ptr<Stage>> stages;// MST -> MAXFLOW -> HAMILTON -> MAXCLIQUE
+    bool fanOut;
+    ResultCache cache;
+
+    // notifyWhenRoom() callbacks, taken by the next stage worker that pops an entry queue;
+    // room_wanted also asks that worker to wake the fan-out admitters waiting on room_cv
+    std::mutex room_mutex;
+    std::vector<std::function<void()>> room_waiters;
+    std::atomic<bool> room_wanted{false};
+
+    // Fan-out admission: a job enters every stage it wants or none (see admit)
+    std::mutex admit_mutex;
+    std::condition_variable room_cv;// Block admitters wait here for a stage queue to have room
+    static constexpr std::chrono::milliseconds ROOM_RETRY{50};// looks again even without a wakeup
 
-    BlockingQueue<JobPtr> q_in, q_mst, q_maxflow, q_ham, q_clique;// queues for different stages
+    // Jobs with a deadline, the soonest first, for expireWorker
+    std::mutex watch_mutex;
+    std::condition_variable watch_cv;
+    std::multimap<std::chrono::steady_clock::time_point, std::weak_ptr<Job>> deadlines;
+    static constexpr std::chrono::milliseconds EXPIRE_RETRY{20};// looks again at an expired job a stage still runs
 };
 
 // Singleton accessor
@@ -0,0 +1,41 @@
+#pragma once
+#include "Graph.hpp"
+#include <cstdint>
+#include <optional>
+
+namespace graph {
+
+// Random graph families for RANDOM requests
+enum class RandomModel {
+    Gnm,            // exactly `edges` edges, uniform over all simple graphs (the default)
+    Gnp,            // every pair independently with `probability`
+    BarabasiAlbert, // preferential attachment, `attach` edges per new vertex
+    Grid,           // `width` columns, row-major, right and down neighbours
+    Geometric       // uniform points in the unit square, edge when closer than `radius`
+};
+
+struct RandomGraphSpec {
+    RandomModel model = RandomModel::Gnm;
+    int vertices = 0;
+    long long edges = 0;// Gnm
+    double probability = 0;// Gnp
+    int attach = 0;// BarabasiAlbert
+    int width = 0;// Grid
+    double radius = 0;// Geometric
+    std::optional<uint64_t> seed;// SEED line: the same spec and seed give the same graph
+};
+
+// Checks the parameters against the vertex count; nullptr if fine, else the parse error text
+const char* validateRandomSpec(const RandomGraphSpec& spec);
+
+/**
+ * Loads a random simple graph (no self-loops, no parallel edges) with weights 1..10
+ * into G, which must have spec.vertices vertices and no edges. Runs in O(V + E)
+ * expected time for every model, split into blocks over `threads` workers (0: one per
+ * core). Each block draws from its own counter-based stream of the seed, so a seeded
+ * request gives the same graph whatever the thread count. Without a seed, one is drawn
+ * from a per-thread engine seeded from std::random_device.
+ */
+void generateRandomGraph(Graph& G, const RandomGraphSpec& spec, unsigned threads = 0);
+
+}
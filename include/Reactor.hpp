@@ -0,0 +1,114 @@
+#pragma once
+#include "Pipeline.hpp"
+#include "RequestParser.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace graph {
+
+/**
+ * Edge-triggered epoll event loop for one I/O thread.
+ * Every reactor owns its own listening socket (SO_REUSEPORT, so the kernel spreads
+ * connections over the reactors), reads requests without blocking and writes the
+ * response once the job's on_complete hook has posted it back. No thread ever waits on a
+ * single client, and the event loop never waits at all: graphs are built and offered to
+ * the pipeline by the reactor's builder thread, so DEPTH and STATS stay answerable under load.
+ *
+ * A plain request ends when the client shuts down its side of the connection, exactly
+ * like the blocking handleClient(). A connection that opens with FRAMED_HELLO instead
+ * stays open and may pipeline any number of framed requests; their responses are
+ * written in completion order, each tagged with its request's tag. With
+ * AdmissionPolicy::Block a job that finds the pipeline full is parked; its connection is
+ * not read from until the pipeline has taken it, which is the back-pressure, while the
+ * other connections carry on.
+ */
+class Reactor {
+    // Finished jobs posted by pipeline threads, and jobs the builder could not queue; shared
+    // with the jobs' on_complete hooks, so it outlives the reactor if a job finishes after shutdown
+    struct Mailbox {
+        std::mutex m;
+        std::vector<std::pair<uint64_t, size_t>> ready;// (connection id, job id)
+        std::vector<std::pair<uint64_t, JobPtr>> full;// (connection id, job) found the pipeline full
+        bool room = false;// a job left the pipeline's entry queue (ThreadPool::notifyWhenRoom)
+        int efd = -1;// eventfd that wakes the reactor
+        ~Mailbox();
+        void post(uint64_t conn, size_t job);
+        void park(uint64_t conn, JobPtr job);
+        void roomFreed();
+        void wake();
+    };
+
+    enum class Mode { Unknown, Plain, Framed };
+
+    struct Pending {
+        std::string tag;// framed mode: echoed in the response
+        JobPtr job;
+        bool parked = false;// waiting in `parked` for room in the pipeline
+    };
+
+    struct Connection {
+        int fd;
+        Mode mode = Mode::Unknown;
+        std::string in;// bytes read and not yet parsed (plain requests go straight to parser)
+        std::unique_ptr<RequestParser> parser;// plain mode
+        std::string out;// responses not yet written
+        size_t sent = 0;// bytes of out already written
+        bool eof = false;// client shut down its side
+        std::unordered_map<size_t, Pending> jobs;// being built or in the pipeline, by job id
+        size_t parked = 0;// jobs waiting for room; nothing is read while there are any
+    };
+
+    struct Parked {
+        uint64_t conn;
+        JobPtr job;
+    };
+
+    static constexpr uint64_t LISTEN_ID = 0, WAKE_ID = 1;// epoll tags, connections start at 2
+    static constexpr int MAX_EVENTS = 64;
+
+    int lfd = -1, epfd = -1;
+    std::shared_ptr<Mailbox> mailbox;
+    std::unordered_map<uint64_t, Connection> conns;
+    uint64_t next_id = 2;
+
+    std::deque<Parked> parked;// oldest first, retried when the pipeline has room
+    bool roomRequested = false;// a notifyWhenRoom() callback is pending
+
+    // Builds the graphs and offers the jobs to the pipeline, off the event loop
+    BlockingQueue<std::function<void()>> builds;
+    std::thread builder;
+
+    void acceptAll();
+    void readFrom(uint64_t id);
+    void parseInput(uint64_t id, Connection& c);
+    void startRequest(uint64_t id, Connection& c, const std::string& tag, std::shared_ptr<RequestParser> parser);
+    static void buildJob(const std::shared_ptr<Mailbox>& box, uint64_t id, RequestParser& parser, const JobPtr& job);
+    void deliverCompleted();
+    void admitParked();
+    void resume(uint64_t id);
+    void respond(Connection& c, const std::string& tag, const std::string& reply);
+    void flush(uint64_t id);
+    void drop(uint64_t id);
+
+public:
+    Reactor() = default;
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Binds the reactor's listening socket and sets up epoll; prints the error and returns false on failure
+    bool open(int port, int backlog);
+
+    // Runs the event loop until running turns false
+    void run(const std::atomic<bool>& running);
+};
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "Graph.hpp"
+#include "Pipeline.hpp"
+#include "RandomGraph.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace graph {
+
+/**
+ * Single-pass parser for one GRAPH / BGRAPH / RANDOM / DEPTH / CACHE / STATS request.
+ * Bytes are fed straight from the receive buffer as they arrive; numbers are read with
+ * std::from_chars (no stream, no locale) and every edge goes into an edge array as soon
+ * as its line is complete, so the request text is never held in memory as a whole; the
+ * graph is built from that array in parallel (Graph::bulkLoad) once the request ends. Only a
+ * token cut in half by a chunk boundary is copied, to be completed by the next chunk.
+ *
+ * A request that starts with the BGRAPH magic is decoded as binary records instead
+ * (see BinaryGraph.hpp); only a record cut by a chunk boundary is copied there.
+ *
+ * Optional header lines come first, then the GRAPH, RANDOM or BGRAPH request:
+ *   ALGS <name>...       only these algorithms (names as in AlgorithmFactory)
+ *   FLOW <s> <t> ...     max flow of each (s,t) pair instead of 0 -> V-1
+ *   FLOW ALL             the min cut (Gomory-Hu) tree, which answers every pair
+ *   MST <part>...        after the MST weight, EDGES: the forest's edges (u v w ...);
+ *                        COMPONENTS: the number of trees and the tree of each vertex
+ *   TIMEOUT <ms>         deadline for the whole job (capped by the server's -t)
+ *   SEED <k>             makes a RANDOM graph reproducible
+ *
+ * RANDOM takes an optional model (see RandomGraph.hpp) and its parameter:
+ *   RANDOM [GNM] V <n> E <edges>    RANDOM GNP V <n> P <probability>
+ *   RANDOM BA V <n> M <edges>       RANDOM GRID V <n> W <width>
+ *   RANDOM GEOMETRIC V <n> R <radius>
+ *
+ * Errors keep the wording of the old istringstream parser ("ERR PARSE_FAILED: ...").
+ * Once an error is found the rest of the input is skipped; the reply is handed out by
+ * finish().
+ */
+class RequestParser {
+    enum class State { Tag, Algs, Flow, Mst, Timeout, Seed, StatsFormat, Model, VKeyword, VValue, EKeyword, EValue, EdgeU, EdgeV, EdgeW,
+                       BinHeader, BinEdges, Done, Failed };
+    enum class Kind { Graph, Random, Depth, Cache, Stats };
+
+    State state = State::Tag;
+    Kind kind = Kind::Graph;
+    unsigned algorithms = 0;// from the ALGS line, 0 = all
+    std::vector<int> flowValues;// FLOW line vertices, paired up by finish() once V is known
+    bool mstParts = false;// the MST line named something
+    AlgorithmParams params;
+    int timeoutMs = 0;// TIMEOUT line, 0 = none
+    bool prometheus = false;// STATS PROMETHEUS
+    RandomGraphSpec random;// RANDOM model and parameter, SEED line
+    std::string carry;// token split across chunks
+    bool newlineBefore = false;// a newline separates the next token from the previous one
+    int V = 0, E = 0;
+    int edges = 0;// edges added so far
+    int u = 0, v = 0;// edge being read
+    std::vector<Graph::EdgeRecord> edgeList;// loaded into the graph in one go by finish()
+    std::string error;
+
+    // BGRAPH
+    bool sniffing = true;// the first bytes are still held in carry to tell BGRAPH from text
+    std::string bin;// header or record split across chunks
+    uint8_t encoding = 0;
+    uint32_t prevSrc = 0, prevDst = 0;// varint deltas
+
+    static constexpr size_t MAX_TOKEN = 64;// longer tokens are invalid in every state
+    static constexpr int EDGE_RESERVE_MAX = 1 << 20;// the E count is trusted this far for preallocation
+
+    void scan(std::string_view chunk);
+    void scanText(std::string_view chunk);
+    void scanBinary(std::string_view chunk);
+    const unsigned char* binaryRecord(const unsigned char* p, const unsigned char* end);
+    bool endHeaderLine();
+    void token(std::string_view t);
+    void addPendingEdge(int w, State next);
+    void fail(const char* message);
+
+public:
+    // Consumes the next chunk of the request
+    void feed(std::string_view chunk);
+
+    /**
+     * Ends the request. Returns true with a pipeline job for GRAPH/RANDOM, or false with
+     * the immediate reply (DEPTH, CACHE, STATS, parse errors).
+     */
+    bool finish(JobPtr& job, std::string& reply);
+
+    /**
+     * finish() in two steps, so that an event loop can leave the expensive one to another
+     * thread: prepare() answers what needs no graph and returns the job without one;
+     * build() then loads or generates the job's graph (false with the ERR reply on failure).
+     */
+    bool prepare(JobPtr& job, std::string& reply);
+    bool build(Job& job, std::string& reply);
+};
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "Algorithm.hpp"
+#include "Graph.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace graph {
+
+struct Job;
+
+// Content address of a graph: two independent 64-bit multiset hashes of the normalized
+// edge list (min(u,v), max(u,v), weight), seeded per process, plus the vertex and edge
+// counts, and the request options that shape the response. It only finds candidates:
+// the cache compares the edges themselves before it reuses a response
+struct CacheKey {
+    uint64_t h1 = 0, h2 = 0;
+    uint32_t vertices = 0;
+    uint64_t edges = 0;
+    uint64_t options = 0;// see optionsKeyOf()
+
+    bool operator==(const CacheKey& o) const {
+        return h1 == o.h1 && h2 == o.h2 && vertices == o.vertices && edges == o.edges && options == o.options;
+    }
+};
+
+struct CacheKeyHash {
+    size_t operator()(const CacheKey& k) const { return static_cast<size_t>(k.h1 ^ k.options); }
+};
+
+// Hashes the frozen graph; independent of edge order and of the edge direction in the request
+CacheKey cacheKeyOf(const Graph& G);
+
+// Hashes the request options that change the response: the algorithm mask and the parameters
+uint64_t optionsKeyOf(unsigned algorithms, const AlgorithmParams& params);
+
+/**
+ * Completed responses by graph content, in front of the pipeline.
+ * Entries are kept in LRU order and evicted once their total size exceeds the byte
+ * budget. A job whose graph is already in flight does not enter the pipeline: it is
+ * parked as a follower of the running job (the leader) and completed with its result.
+ * Only jobs without a deadline coalesce, so no job inherits another one's time limit.
+ * A response is only reused for the same edges: entries keep the graph's canonical edge
+ * list and flights the leader's graph, and both are compared with the job's graph, so
+ * two graphs whose keys collide never share an answer.
+ */
+class ResultCache {
+public:
+    enum class Lookup { Hit, Joined, Miss };
+
+    struct Counters {
+        uint64_t hits, misses, coalesced, evictions;
+        size_t entries, bytes, capacity;
+    };
+
+    explicit ResultCache(size_t capacityBytes) : capacity(capacityBytes) {}
+
+    bool enabled() const { return capacity != 0; }
+
+    /**
+     * Hit: result holds the cached response. Joined: job waits for the in-flight leader.
+     * Miss: job must run and finish() must follow; it became the leader for key if it may
+     * coalesce (and no different graph with the same key is in flight), otherwise it runs
+     * on its own and no other job joins it.
+     */
+    Lookup lookup(const CacheKey& key, const std::shared_ptr<Job>& job, std::string& result, bool coalesce);
+
+    // Ends the leader's flight; stores the response for graph if cacheable and returns the followers to complete
+    std::vector<std::shared_ptr<Job>> finish(const CacheKey& key, size_t leader, const Graph& graph,
+                                             const std::string& result, bool cacheable);
+
+    // Ends the leader's flight early if no follower waits on it; false if one does
+    bool abandon(const CacheKey& key, size_t leader);
+
+    Counters counters() const;
+
+    // One undirected edge in canonical form: u <= v; a graph's list is sorted by (u, v, weight)
+    struct CanonicalEdge {
+        int u, v, weight;
+        bool operator==(const CanonicalEdge& o) const { return u == o.u && v == o.v && weight == o.weight; }
+    };
+    using CanonicalEdges = std::vector<CanonicalEdge>;
+
+private:
+    struct Entry {
+        CacheKey key;
+        std::string result;
+        std::shared_ptr<const CanonicalEdges> edges;// what the response answers; compared on every hit
+    };
+
+    struct Flight {
+        size_t leader;// job id
+        std::shared_ptr<const Graph> graph;// the leader's; compared before a job joins
+        std::vector<std::shared_ptr<Job>> followers;
+    };
+
+    static size_t entryBytes(size_t resultBytes, size_t edges) {
+        return resultBytes + edges * sizeof(CanonicalEdge) + ENTRY_OVERHEAD;
+    }
+
+    static constexpr size_t ENTRY_OVERHEAD = 96;// list node, map node and key, roughly
+
+    const size_t capacity;
+    mutable std::mutex m;
+    std::list<Entry> lru;// most recently used first
+    std::unordered_map<CacheKey, std::list<Entry>::iterator, CacheKeyHash> index;
+    std::unordered_map<CacheKey, Flight, CacheKeyHash> inflight;
+    size_t bytes = 0;
+    uint64_t hits = 0, misses = 0, coalesced = 0, evictions = 0;
+};
+
+}
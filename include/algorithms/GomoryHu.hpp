@@ -0,0 +1,34 @@
+#pragma once
+#include "CancelToken.hpp"
+#include "Graph.hpp"
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/**
+ * Flow-equivalent tree of an undirected graph (Gusfield's Gomory-Hu construction): the
+ * max flow between any two vertices is the lightest edge on their tree path. Vertex 0
+ * is the root; every other vertex v hangs below parent[v] < v with edge weight[v].
+ */
+struct GomoryHuTree {
+    std::vector<int> parent;
+    std::vector<long long> weight;
+    std::vector<int> depth;
+
+    // Max flow (min cut) between u and v, read off the tree in O(path length)
+    long long min_cut(int u, int v) const;
+};
+
+// Builds the tree with n-1 max flow calls on `threads` workers (0 = one per core). If
+// cancel fires, no further max flow starts and *stopped is set: the tree is incomplete then
+GomoryHuTree gomory_hu_tree(const Graph& G, unsigned threads = 0, const CancelToken* cancel = nullptr,
+                            bool* stopped = nullptr);
+
+// Max flow of every (s,t) pair: from the tree when that takes fewer max flow calls,
+// otherwise one call per pair, spread over `threads` workers (0 = one per core).
+// cancel and stopped as for gomory_hu_tree(); the flows are incomplete if it stopped
+std::vector<long long> max_flows(const Graph& G, const std::vector<std::pair<int, int>>& pairs,
+                                 unsigned threads = 0, const CancelToken* cancel = nullptr, bool* stopped = nullptr);
+
+}
@@ -1,6 +1,21 @@
 #pragma once
+#include "CancelToken.hpp"
 #include "Graph.hpp"
 #include <vector>
+#include <string>
+#include <cstdint>
 
-// Finds a Hamiltonian cycle in the given graph, if it exists.
-std::vector<int> find_hamiltonian_cycle(const graph::Graph& G);
+// Largest graph handled by the bitmask DP (2^(n-1) x 4 bytes of state, 64 MB at 25)
+constexpr int HELD_KARP_MAX_VERTICES = 25;
+
+// What the Hamiltonian search did, for tuning under load
+struct HamiltonStats {
+    std::string strategy;   // "trivial", "precheck", "held-karp" or "branch-and-bound"
+    uint64_t nodes = 0;     // DP states evaluated or search nodes expanded
+    bool stopped = false;   // gave up on the cancel token: "no cycle" is then not an answer
+    size_t longestPath = 0; // vertices on the longest path from the start seen so far
+};
+
+// Finds a Hamiltonian cycle in the given graph, if it exists; the search gives up once cancel asks it to.
+std::vector<int> find_hamiltonian_cycle(const graph::Graph& G, HamiltonStats* stats = nullptr,
+                                        const graph::CancelToken* cancel = nullptr);
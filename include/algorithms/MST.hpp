@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <memory_resource>
 #include <vector>
 #include <tuple>
 
@@ -7,4 +9,48 @@ namespace graph {
     class Graph;
 }
 
+// How compute_mst_weight() finds the minimum spanning forest
+enum class MstStrategy {
+    Auto,          // picked by choose_mst_strategy()
+    Kruskal,       // sort every edge, then union-find (the reference)
+    FilterKruskal, // quicksort-style partitioning, edges inside a component dropped early
+    Boruvka,       // parallel rounds of cheapest-edge-per-component
+    Prim           // indexed binary heap over the CSR lists, for dense graphs
+};
+
+// Edge density (E over the number of vertex pairs) from which Auto picks Prim
+constexpr double PRIM_MIN_DENSITY = 0.25;
+// Auto picks Boruvka for graphs with this many edges once this many workers are available:
+// on one thread its memory-bound rounds take about three times as long as Filter-Kruskal
+constexpr size_t BORUVKA_MIN_EDGES = size_t(1) << 18;
+constexpr unsigned BORUVKA_MIN_THREADS = 8;
+
+struct MstEdge {
+    int u, v, weight;
+};
+
+// A minimum spanning forest: its weight, the edges taken and the tree each vertex ended up in
+struct MstForest {
+    long long weight = 0;
+    std::pmr::vector<MstEdge> edges;// in the order the strategy took them
+    std::pmr::vector<int> component;// component[v] = tree of v; trees are numbered in order of their lowest vertex
+    int components = 0;
+
+    explicit MstForest(std::pmr::memory_resource* mr = std::pmr::get_default_resource()) : edges(mr), component(mr) {}
+};
+
 long long mst_weight_kruskal(const graph::Graph& G);
+
+// The strategy Auto resolves to for G with `threads` workers (0 = one per core)
+MstStrategy choose_mst_strategy(const graph::Graph& G, unsigned threads = 0);
+
+const char* mst_strategy_name(MstStrategy strategy);
+
+// Weight of a minimum spanning forest of G (the sum over its connected components); every
+// strategy gives the same weight. *used, if given, receives the strategy that ran
+long long compute_mst_weight(const graph::Graph& G, MstStrategy strategy = MstStrategy::Auto,
+                             unsigned threads = 0, MstStrategy* used = nullptr);
+
+// Same as compute_mst_weight, but also records the forest's edges and component labels in the same pass
+void compute_mst_forest(const graph::Graph& G, MstForest& forest, MstStrategy strategy = MstStrategy::Auto,
+                        unsigned threads = 0, MstStrategy* used = nullptr);
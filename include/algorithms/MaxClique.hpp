@@ -1,10 +1,16 @@
 #pragma once
+#include "CancelToken.hpp"
 #include "Graph.hpp"
 #include <vector>
 
 namespace graph {
 
-// Finds the maximum clique in a graph.
-std::vector<int> find_max_clique(const Graph& G);
+// Fewer top-level tasks than this per worker and the search stays on the calling thread
+constexpr unsigned PARALLEL_MIN_TASKS_PER_WORKER = 32;
+
+// Finds the maximum clique in a graph, using `threads` workers (0 = one per core).
+// If cancel fires first, *stopped is set and the best clique found so far is returned.
+std::vector<int> find_max_clique(const Graph& G, unsigned threads = 0, const CancelToken* cancel = nullptr,
+                                 bool* stopped = nullptr);
 
 }
@@ -1,80 +1,292 @@
+#pragma once
+#include "Arena.hpp"
+#include <memory_resource>
 #include <vector>
 #include <queue>
 #include <algorithm>
 #include <stdexcept>
 #include <cstdint>
+#include <limits>
 
+/**
+ * Flow network with 64-bit capacities. Arcs are added with addEdge(), then packed into
+ * CSR arrays by finalize() or the first query; the packed network is never modified, so
+ * one MaxFlow can answer any number of (s,t) queries, also from several threads at
+ * once. Each query works on its own copy of the residual capacities, allocated like
+ * its other temporaries from graph::scratch().
+ */
 class MaxFlow {
-    struct Edge {
-        int to, rev;
-        int cap;
+public:
+    enum class Strategy { Auto, Dinic, PushRelabel };
+
+private:
+    struct Arc {
+        int from, to;
+        int64_t cap, revCap;
     };
 
     int n;
-    std::vector<std::vector<Edge>> adj;
+    std::pmr::vector<Arc> pending;// arcs added before finalize()
 
-public:
-    explicit MaxFlow(int n) : n(n), adj(n) {}
+    // Packed residual network: arcs of u are [head[u], head[u+1]); arc e pairs with rev[e]
+    std::pmr::vector<int> head, to, rev;
+    std::pmr::vector<int64_t> cap;
+
+    template<typename T>
+    using Scratch = std::pmr::vector<T>;
 
-    // Adds a directed edge from u to v with capacity cap
-    void addEdge(int u, int v, int cap) {
-        if (cap < 0) throw std::invalid_argument("Capacity must be non-negative");
-        adj[u].push_back({v, (int)adj[v].size(), cap});
-        adj[v].push_back({u, (int)adj[u].size() - 1, 0}); // reverse edge
+    void pack() {
+        if (!head.empty()) return;
+        Scratch<int> deg(n + 1, 0, graph::scratch());
+        for (const auto& a : pending) { ++deg[a.from]; ++deg[a.to]; }
+        head.assign(n + 1, 0);
+        for (int u = 0; u < n; ++u) head[u + 1] = head[u] + deg[u];
+
+        size_t m = head[n];
+        to.assign(m, 0); rev.assign(m, 0); cap.assign(m, 0);
+        Scratch<int> pos(head.begin(), head.end() - 1, graph::scratch());
+        for (const auto& a : pending) {
+            int e = pos[a.from]++, r = pos[a.to]++;
+            to[e] = a.to;   rev[e] = r; cap[e] = a.cap;
+            to[r] = a.from; rev[r] = e; cap[r] = a.revCap;
+        }
+        pending.clear();
+        pending.shrink_to_fit();
     }
 
-    /**
-     * Computes the maximum flow from source s to sink t
-     * using the Edmonds-Karp algorithm (BFS-based Ford-Fulkerson).
-     * @param s Source vertex
-     * @param t Sink vertex
-     * @return Maximum flow from source s to sink t
-     */
-    int getMaxFlow(int s, int t) {
-        int flow = 0;
-        std::vector<int> level(n), parent(n), parentEdge(n);
-        // BFS to find augmenting path
+    // Dinic: BFS level graph, then blocking flow by iterative DFS with current-arc pointers
+    int64_t dinic(int s, int t, Scratch<int64_t>& res) const {
+        int64_t flow = 0;
+        std::pmr::memory_resource* mr = graph::scratch();
+        Scratch<int> level(n, mr), it(n, mr), path(mr);// path holds arc indices from s
+        Scratch<int> q(n, mr);
         while (true) {
-            std::fill(level.begin(), level.end(), -1);// Reset level
-            std::queue<int> q;
-            q.push(s);
+            std::fill(level.begin(), level.end(), -1);
+            int qh = 0, qt = 0;
+            q[qt++] = s;
             level[s] = 0;
+            while (qh < qt && level[t] < 0) {
+                int u = q[qh++];
+                for (int e = head[u]; e < head[u + 1]; ++e) {
+                    if (res[e] > 0 && level[to[e]] < 0) {
+                        level[to[e]] = level[u] + 1;
+                        q[qt++] = to[e];
+                    }
+                }
+            }
+            if (level[t] < 0) break;// no more augmenting paths
 
-            // BFS to find augmenting path
-            while (!q.empty()) {
-                int u = q.front(); q.pop();
-                for (size_t i = 0; i < adj[u].size(); ++i) {
-                    Edge &e = adj[u][i];
-                    if (level[e.to] < 0 && e.cap > 0) {
-                        level[e.to] = level[u] + 1;
-                        parent[e.to] = u;
-                        parentEdge[e.to] = i;// Store the edge index
-                        q.push(e.to);
+            for (int u = 0; u < n; ++u) it[u] = head[u];
+            path.clear();
+            int u = s;
+            while (true) {
+                if (u == t) {
+                    int64_t aug = std::numeric_limits<int64_t>::max();
+                    for (int e : path) aug = std::min(aug, res[e]);
+                    size_t firstSaturated = path.size();
+                    for (size_t i = 0; i < path.size(); ++i) {
+                        int e = path[i];
+                        res[e] -= aug;
+                        res[rev[e]] += aug;
+                        if (res[e] == 0 && firstSaturated == path.size()) firstSaturated = i;
                     }
+                    flow += aug;
+                    path.resize(firstSaturated);// retreat to the tail of the first saturated arc
+                    u = path.empty() ? s : to[path.back()];
+                    continue;
                 }
+                int& e = it[u];
+                while (e < head[u + 1] && !(res[e] > 0 && level[to[e]] == level[u] + 1)) ++e;
+                if (e < head[u + 1]) {// advance
+                    path.push_back(e);
+                    u = to[e];
+                    continue;
+                }
+                if (u == s) break;// blocking flow done
+                level[u] = -1;// dead end: retreat
+                path.pop_back();
+                u = path.empty() ? s : to[path.back()];
+                ++it[u];
             }
+        }
+        return flow;
+    }
 
-            if (level[t] < 0) break; // no more augmenting paths
+    // Highest-label push-relabel with gap and periodic global relabeling (first phase
+    // only: the excess that reaches t is the max flow value)
+    int64_t pushRelabel(int s, int t, Scratch<int64_t>& res) const {
+        std::pmr::memory_resource* mr = graph::scratch();
+        Scratch<int64_t> excess(n, 0, mr);
+        Scratch<int> height(n, 0, mr), count(2 * n + 1, 0, mr), cur(n, mr), q(mr);
+        Scratch<Scratch<int>> bucket(n, mr);// active vertices by height (lazy)
+        int highest = -1;
+
+        auto activate = [&](int v) {
+            if (v == s || v == t || height[v] >= n) return;
+            bucket[height[v]].push_back(v);
+            highest = std::max(highest, height[v]);
+        };
+
+        // Exact distances to t in the residual graph; vertices that can't reach t are lifted to n
+        auto globalRelabel = [&]() {
+            std::fill(height.begin(), height.end(), n);
+            std::fill(count.begin(), count.end(), 0);
+            q.assign(1, t);
+            height[t] = 0;
+            for (size_t qi = 0; qi < q.size(); ++qi) {
+                int u = q[qi];
+                for (int e = head[u]; e < head[u + 1]; ++e) {
+                    int w = to[e];
+                    if (w != s && height[w] == n && res[rev[e]] > 0) {
+                        height[w] = height[u] + 1;
+                        q.push_back(w);
+                    }
+                }
+            }
+            for (auto& b : bucket) b.clear();
+            highest = -1;
+            for (int v = 0; v < n; ++v) {
+                if (height[v] < n) ++count[height[v]];
+                cur[v] = head[v];
+                if (excess[v] > 0) activate(v);
+            }
+        };
 
-            // Find minimum capacity along the path
-            int aug = INT32_MAX;
-            // Find the minimum capacity along the path
-            for (int v = t; v != s; v = parent[v]) {
-                int u = parent[v];
-                aug = std::min(aug, adj[u][parentEdge[v]].cap);
+        height[s] = n;
+        for (int e = head[s]; e < head[s + 1]; ++e) {
+            if (res[e] > 0) {
+                excess[to[e]] += res[e];
+                res[rev[e]] += res[e];
+                res[e] = 0;
             }
+        }
+        globalRelabel();
 
-            // Augment the flow along the path
-            for (int v = t; v != s; v = parent[v]) {
-                int u = parent[v];
-                Edge &e = adj[u][parentEdge[v]];
-                e.cap -= aug;
-                adj[e.to][e.rev].cap += aug;// Update reverse edge capacity
+        long long work = 0;
+        const long long relabelEvery = 6LL * n + static_cast<long long>(head[n]);
+        while (highest >= 0) {
+            if (bucket[highest].empty()) { --highest; continue; }
+            int v = bucket[highest].back();
+            bucket[highest].pop_back();
+            if (height[v] != highest || excess[v] == 0) continue;// stale entry
+
+            // discharge v
+            while (excess[v] > 0) {
+                if (cur[v] == head[v + 1]) {// relabel
+                    int oldH = height[v], newH = 2 * n;
+                    for (int e = head[v]; e < head[v + 1]; ++e) {
+                        if (res[e] > 0) newH = std::min(newH, height[to[e]] + 1);
+                    }
+                    work += head[v + 1] - head[v] + 12;
+                    --count[oldH];
+                    if (count[oldH] == 0) {// gap: nothing above oldH can reach t any more
+                        for (int u = 0; u < n; ++u) {
+                            if (height[u] > oldH && height[u] < n) {
+                                --count[height[u]];
+                                height[u] = n;
+                            }
+                        }
+                        newH = n;
+                    }
+                    height[v] = std::min(newH, n);
+                    if (height[v] < n) ++count[height[v]];
+                    cur[v] = head[v];
+                    if (height[v] >= n) break;
+                    continue;
+                }
+                int e = cur[v], w = to[e];
+                if (res[e] > 0 && height[v] == height[w] + 1) {
+                    int64_t d = std::min(excess[v], res[e]);
+                    bool wasIdle = excess[w] == 0;
+                    res[e] -= d; res[rev[e]] += d;
+                    excess[v] -= d; excess[w] += d;
+                    if (wasIdle) activate(w);
+                    if (excess[v] == 0) break;
+                }
+                ++cur[v];
             }
+            if (excess[v] > 0) activate(v);
 
-            flow += aug;// Update total flow
+            if (work > relabelEvery) {
+                work = 0;
+                globalRelabel();
+            }
         }
+        return excess[t];
+    }
+
+public:
+    explicit MaxFlow(int n, std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : n(n), pending(mr), head(mr), to(mr), rev(mr), cap(mr) {}
+
+    // Adds a directed edge from u to v with capacity cap (and capacity revCap back from v to u)
+    void addEdge(int u, int v, int64_t cap, int64_t revCap = 0) {
+        if (cap < 0 || revCap < 0) throw std::invalid_argument("Capacity must be non-negative");
+        if (u < 0 || u >= n || v < 0 || v >= n) throw std::out_of_range("Vertex index out of range");
+        if (!head.empty()) throw std::logic_error("MaxFlow network already finalized");
+        if (u == v) return;// self-loops never carry flow
+        pending.push_back({u, v, cap, revCap});
+    }
+
+    // Packs pending arcs now, so later const queries are safe from several threads
+    void finalize() { pack(); }
+
+    int num_arcs() const { return head.empty() ? 0 : head[n]; }
+
+    /**
+     * Computes the maximum flow from source s to sink t.
+     * Auto picks push-relabel for dense networks (at least n^2/4 arcs) and Dinic otherwise.
+     * @param s Source vertex
+     * @param t Sink vertex
+     * @return Maximum flow from source s to sink t
+     */
+    int64_t getMaxFlow(int s, int t, Strategy strategy = Strategy::Auto) {
+        pack();
+        return static_cast<const MaxFlow&>(*this).getMaxFlow(s, t, strategy);
+    }
 
+    int64_t getMaxFlow(int s, int t, Strategy strategy = Strategy::Auto) const {
+        Scratch<int64_t> res(graph::scratch());
+        return solve(s, t, strategy, res);
+    }
+
+    /**
+     * Computes the maximum flow from s to t together with a minimum s-t cut.
+     * @param sourceSide Set to 1 for the vertices on s's side of the cut: those that can no
+     * longer reach t in the residual network (valid for both strategies).
+     * @return Maximum flow from s to t, which is the capacity of the cut
+     */
+    int64_t getMinCut(int s, int t, std::vector<char>& sourceSide, Strategy strategy = Strategy::Auto) const {
+        Scratch<int64_t> res(graph::scratch());
+        int64_t flow = solve(s, t, strategy, res);
+        sourceSide.assign(n, 1);
+        Scratch<int> q(1, t, res.get_allocator());
+        sourceSide[t] = 0;
+        for (size_t qi = 0; qi < q.size(); ++qi) {
+            int u = q[qi];
+            for (int e = head[u]; e < head[u + 1]; ++e) {
+                int w = to[e];
+                if (sourceSide[w] && res[rev[e]] > 0) {// w -> u still has residual capacity
+                    sourceSide[w] = 0;
+                    q.push_back(w);
+                }
+            }
+        }
         return flow;
     }
-};
+
+private:
+    // Runs one query; res is left with the final residual capacities
+    int64_t solve(int s, int t, Strategy strategy, Scratch<int64_t>& res) const {
+        if (s < 0 || s >= n || t < 0 || t >= n) throw std::out_of_range("Vertex index out of range");
+        if (head.empty()) throw std::logic_error("MaxFlow network not finalized");
+        res = cap;// residual capacities for this query only
+        if (s == t) return 0;
+
+        if (strategy == Strategy::Auto) {
+            bool dense = static_cast<long long>(head[n]) * 4 >= static_cast<long long>(n) * n;
+            strategy = dense ? Strategy::PushRelabel : Strategy::Dinic;
+        }
+        return strategy == Strategy::PushRelabel ? pushRelabel(s, t, res) : dinic(s, t, res);
+    }
+};
\ No newline at end of file
@@ -1,6 +1,20 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include "Pipeline.hpp"
 
 bool readAllText(int fd, std::string &out);
 bool writeAll(int fd, const std::string &s);
+bool parseRequest(std::string_view req, graph::JobPtr& job, std::string& reply);
 void handleClient(int cfd);
+
+// Framed protocol (persistent connections, see server.cpp)
+extern const std::string FRAMED_HELLO;
+constexpr size_t MAX_FRAME_BYTES = 64u << 20;// largest request body accepted in one frame
+constexpr size_t MAX_FRAME_HEADER = 256;
+enum class FrameStatus { NeedMore, Frame, Bad };
+
+bool couldBeFramed(const std::string &buf);
+FrameStatus takeFrame(const std::string &buf, size_t &pos, std::string &tag, std::string_view &payload);
+std::string encodeFrame(const std::string &tag, const std::string &body);
@@ -0,0 +1,222 @@
+#include "Arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace graph {
+
+namespace {
+
+using Chunk = Arena::Chunk;
+
+constexpr size_t MIN_CHUNK = size_t(64) << 10;
+constexpr size_t MAX_GROWTH = size_t(64) << 20;// a new chunk is as big as the arena so far, up to this
+constexpr size_t MAX_POOLED_CHUNK = size_t(64) << 20;// bigger chunks go straight back to the heap
+constexpr size_t THREAD_CACHE_CHUNKS = 8;
+constexpr size_t SHARED_POOL_BYTES = size_t(256) << 20;
+constexpr size_t SCRATCH_RETAIN_BYTES = size_t(64) << 20;// a worker's scratch keeps at most this between runs
+
+// Removes and returns the smallest chunk of at least minBytes, if any
+bool takeBestFit(std::vector<Chunk>& from, size_t minBytes, Chunk& out) {
+    auto best = from.end();
+    for (auto it = from.begin(); it != from.end(); ++it) {
+        if (it->size >= minBytes && (best == from.end() || it->size < best->size)) best = it;
+    }
+    if (best == from.end()) return false;
+    out = *best;
+    *best = from.back();
+    from.pop_back();
+    return true;
+}
+
+// Chunks no thread has cached. Never destroyed: threads return theirs while exiting
+struct SharedChunks {
+    std::mutex m;
+    std::vector<Chunk> chunks;
+    size_t bytes = 0;
+
+    static SharedChunks& instance() {
+        static SharedChunks* pool = new SharedChunks();
+        return *pool;
+    }
+
+    void give(Chunk c) {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            if (bytes + c.size <= SHARED_POOL_BYTES) {
+                chunks.push_back(c);
+                bytes += c.size;
+                return;
+            }
+        }
+        ::operator delete(c.base);
+    }
+
+    bool take(size_t minBytes, Chunk& out) {
+        std::lock_guard<std::mutex> lk(m);
+        if (!takeBestFit(chunks, minBytes, out)) return false;
+        bytes -= out.size;
+        return true;
+    }
+};
+
+// The calling thread's chunks: taken and returned without any lock
+struct ChunkCache {
+    std::vector<Chunk> chunks;
+    ~ChunkCache() {
+        for (const Chunk& c : chunks) SharedChunks::instance().give(c);
+    }
+
+    static ChunkCache& local() {
+        thread_local ChunkCache cache;
+        return cache;
+    }
+};
+
+Chunk takeChunk(size_t minBytes) {
+    Chunk c;
+    if (takeBestFit(ChunkCache::local().chunks, minBytes, c)) return c;
+    if (SharedChunks::instance().take(minBytes, c)) return c;
+    size_t size = MIN_CHUNK;
+    while (size < minBytes) size *= 2;
+    return {static_cast<char*>(::operator new(size)), size};
+}
+
+void giveChunk(Chunk c) {
+    if (c.size > MAX_POOLED_CHUNK) {
+        ::operator delete(c.base);
+        return;
+    }
+    std::vector<Chunk>& cache = ChunkCache::local().chunks;
+    if (cache.size() < THREAD_CACHE_CHUNKS) cache.push_back(c);
+    else SharedChunks::instance().give(c);
+}
+
+// Scratch arena of this thread and the number of open ScratchScopes on it
+struct ScratchState {
+    Arena arena;
+    int depth = 0;
+
+    static ScratchState& local() {
+        ChunkCache::local();// constructed first, so it outlives the arena that returns chunks to it
+        thread_local ScratchState state;
+        return state;
+    }
+};
+
+}
+
+/**
+ * @brief Creates an empty arena; no memory is taken until the first allocation.
+ * @param firstChunk Size of the first chunk, e.g. the expected total; later chunks grow.
+ * @param locked Whether several threads may allocate from it.
+ */
+Arena::Arena(size_t firstChunk, bool locked) : firstChunk(firstChunk), locked(locked) {}
+
+Arena::~Arena() {
+    releaseUnlocked();
+}
+
+Arena::Mark Arena::mark() const {
+    std::unique_lock<std::mutex> lk(m, std::defer_lock);
+    if (locked) lk.lock();
+    return {current, offset};
+}
+
+/**
+ * @brief Frees everything allocated after m was taken. The chunks stay in the arena and
+ * are filled again from the mark on.
+ */
+void Arena::rewind(const Mark& mk) {
+    std::unique_lock<std::mutex> lk(m, std::defer_lock);
+    if (locked) lk.lock();
+    current = mk.chunk;
+    offset = mk.offset;
+}
+
+void Arena::release() {
+    std::unique_lock<std::mutex> lk(m, std::defer_lock);
+    if (locked) lk.lock();
+    releaseUnlocked();
+}
+
+void Arena::releaseUnlocked() {
+    for (const Chunk& c : chunks) giveChunk(c);
+    chunks.clear();
+    current = offset = 0;
+}
+
+size_t Arena::bytesUsed() const {
+    std::unique_lock<std::mutex> lk(m, std::defer_lock);
+    if (locked) lk.lock();
+    size_t used = chunks.empty() ? 0 : offset;
+    for (size_t i = 0; i < current && i < chunks.size(); ++i) used += chunks[i].size;
+    return used;
+}
+
+size_t Arena::bytesReserved() const {
+    std::unique_lock<std::mutex> lk(m, std::defer_lock);
+    if (locked) lk.lock();
+    size_t reserved = 0;
+    for (const Chunk& c : chunks) reserved += c.size;
+    return reserved;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t align) {
+    std::unique_lock<std::mutex> lk(m, std::defer_lock);
+    if (locked) lk.lock();
+    return bump(bytes, align);
+}
+
+/**
+ * @brief Carves bytes out of the current chunk. When they don't fit, moves on to the next
+ * chunk the arena already holds (after a rewind) or, if that one is too small, inserts a
+ * fresh chunk from the pool at least as large as the whole arena so far.
+ */
+void* Arena::bump(size_t bytes, size_t align) {
+    auto fit = [&](const Chunk& c, size_t from) -> size_t {// offset of the block in c, or c.size + 1
+        uintptr_t base = reinterpret_cast<uintptr_t>(c.base);
+        size_t at = static_cast<size_t>(((base + from + align - 1) & ~(uintptr_t(align) - 1)) - base);
+        return at <= c.size && bytes <= c.size - at ? at : c.size + 1;
+    };
+
+    while (current < chunks.size()) {
+        const Chunk& c = chunks[current];
+        size_t at = fit(c, offset);
+        if (at <= c.size) {
+            offset = at + bytes;
+            return c.base + at;
+        }
+        if (current + 1 == chunks.size() || fit(chunks[current + 1], 0) > chunks[current + 1].size) break;
+        ++current;
+        offset = 0;
+    }
+
+    size_t reserved = 0;
+    for (const Chunk& c : chunks) reserved += c.size;
+    size_t size = std::max({bytes + align, firstChunk, std::min(reserved, MAX_GROWTH)});
+    size_t at = chunks.empty() ? 0 : current + 1;
+    chunks.insert(chunks.begin() + static_cast<std::ptrdiff_t>(at), takeChunk(size));
+    current = at;
+    size_t start = fit(chunks[current], 0);
+    offset = start + bytes;
+    return chunks[current].base + start;
+}
+
+ScratchScope::ScratchScope() {
+    ScratchState& s = ScratchState::local();
+    mark = s.arena.mark();
+    ++s.depth;
+}
+
+ScratchScope::~ScratchScope() {
+    ScratchState& s = ScratchState::local();
+    s.arena.rewind(mark);
+    if (--s.depth == 0 && s.arena.bytesReserved() > SCRATCH_RETAIN_BYTES) s.arena.release();// after an outsized run
+}
+
+std::pmr::memory_resource* scratch() {
+    ScratchState& s = ScratchState::local();
+    return s.depth > 0 ? static_cast<std::pmr::memory_resource*>(&s.arena) : std::pmr::new_delete_resource();
+}
+
+}
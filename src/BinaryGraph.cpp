@@ -0,0 +1,70 @@
+#include "BinaryGraph.hpp"
+#include <algorithm>
+
+namespace graph {
+namespace bgraph {
+
+namespace {
+
+void putU32(std::string& out, uint32_t x) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((x >> (8 * i)) & 0xff);
+}
+
+void putVarint(std::string& out, uint32_t x) {
+    while (x >= 0x80) {
+        out += static_cast<char>((x & 0x7f) | 0x80);
+        x >>= 7;
+    }
+    out += static_cast<char>(x);
+}
+
+uint32_t zigzag(int32_t w) {
+    return (static_cast<uint32_t>(w) << 1) ^ static_cast<uint32_t>(w >> 31);
+}
+
+}
+
+/**
+ * @brief Encodes a graph as a BGRAPH request.
+ * @param V Number of vertices.
+ * @param edges Undirected edges; VARINT stores each with src <= dst, sorted.
+ * @param encoding RAW or VARINT records.
+ * @return The request bytes.
+ */
+std::string encode(uint32_t V, std::vector<Edge> edges, Encoding encoding) {
+    std::string out(MAGIC, MAGIC_SIZE);
+    out += static_cast<char>(VERSION);
+    out += static_cast<char>(encoding);
+    putU32(out, V);
+    putU32(out, static_cast<uint32_t>(edges.size()));
+
+    if (encoding == RAW) {
+        out.reserve(out.size() + edges.size() * RAW_RECORD_SIZE);
+        for (const auto& e : edges) {
+            putU32(out, e.src);
+            putU32(out, e.dst);
+            putU32(out, static_cast<uint32_t>(e.weight));
+        }
+        return out;
+    }
+
+    for (auto& e : edges) {
+        if (e.src > e.dst) std::swap(e.src, e.dst);
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+        return a.src != b.src ? a.src < b.src : a.dst < b.dst;
+    });
+    uint32_t prevSrc = 0, prevDst = 0;
+    for (const auto& e : edges) {
+        uint32_t dsrc = e.src - prevSrc;
+        putVarint(out, dsrc);
+        putVarint(out, dsrc == 0 ? e.dst - prevDst : e.dst);
+        putVarint(out, zigzag(e.weight));
+        prevSrc = e.src;
+        prevDst = e.dst;
+    }
+    return out;
+}
+
+}
+}
@@ -7,6 +7,8 @@
 #include "Graph.hpp"
 #include "algorithms/MST.hpp" // Include the MST algorithm for minimum spanning tree functionality
 #include "algorithms/MaxFlow.hpp" // Include the MaxFlow algorithm
+#include "Parallel.hpp"
+#include <atomic>
 #include <stack>
 #include <algorithm>
 
@@ -16,9 +18,12 @@ namespace graph {
 /**
  * @brief Constructs a graph with the given number of vertices.
  * @param num_ver The number of vertices in the graph.
+ * @param mr Memory for the frozen (CSR) arrays and the flow network; the adjacency lists
+ * used while building stay on the heap, since an arena would keep every outgrown copy.
  * @throws std::invalid_argument if the number of vertices is invalid.
  */
-Graph::Graph(int num_ver) : num_of_vertex(num_ver) {
+Graph::Graph(int num_ver, std::pmr::memory_resource* mr)
+    : num_of_vertex(num_ver), resource(mr), csr_offsets(mr), csr_edges(mr), adj_bits(mr) {
     // if ( num_ver <= 0) {
     //     throw std::invalid_argument("Invalid number of vertex");
     // }//there is already a check in the server
@@ -32,6 +37,9 @@ Graph::Graph(int num_ver) : num_of_vertex(num_ver) {
  * @param w Weight of the edge.
  */
 void Graph::addEdge(int src, int dest, int w) {
+    if (frozen) {
+        throw std::logic_error("Cannot add edges to a frozen graph");
+    }
     validVertex(src);
     validVertex(dest);
 
@@ -50,6 +58,18 @@ int Graph::get_num_of_vertex() const{
     return num_of_vertex;
 }
 
+/**
+ * @brief Returns the number of adjacency entries, i.e. twice the number of edges
+ * (a self-loop counts once). O(1) once frozen, O(V) before.
+ * @return The number of adjacency entries.
+ */
+size_t Graph::get_num_of_arcs() const {
+    if (frozen) return csr_edges.size();
+    size_t arcs = 0;
+    for (const auto& list : adj_list) arcs += list.size();
+    return arcs;
+}
+
 /**
  * @brief Retrieves all edges in the graph.
  * @param numEdges Reference to store the number of edges found.
@@ -59,7 +79,7 @@ std::vector<std::tuple<int,int,int>> Graph::get_edges() const {
     std::vector<std::tuple<int,int,int>> edges;
 
     for (int i = 0; i < num_of_vertex; ++i) {
-        for(const auto& edge : adj_list[i]) {
+        for(const auto& edge : neighbors(i)) {
             if(i < edge.dest) { // to avoid duplicates in undirected graphs
                 edges.emplace_back(i, edge.dest, edge.weight);
             }
@@ -84,7 +104,7 @@ void Graph::validVertex(int v) const {
 
 //function to find the minimum spanning tree weight
 long long Graph::mst_weight() const {
-    return mst_weight_kruskal(*this);
+    return compute_mst_weight(*this);
 }
 
 /*
@@ -93,28 +113,281 @@ long long Graph::mst_weight() const {
  * @param b Sink vertex
  * @return The maximum flow value.
  */
-int Graph::max_flow(int a, int b) const {
-    int n = num_of_vertex;
-    MaxFlow mf(n);
+long long Graph::max_flow(int a, int b) const {
+    validVertex(a);
+    validVertex(b);
+    return flowNetwork()->getMaxFlow(a, b);
+}
 
-    // Initialize the MaxFlow object with the graph's edges
-    for (int u = 0; u < n; ++u) {
-        for (auto &e : adj_list[u]) {
-            mf.addEdge(u, e.dest, e.weight);
+/*
+ * @brief Computes the maximum flow from source to sink and a minimum cut between them
+ * @param a Source vertex
+ * @param b Sink vertex
+ * @param source_side Filled with one flag per vertex, 1 for the vertices on the source side.
+ * @return The maximum flow value, equal to the weight of the cut.
+ */
+long long Graph::min_cut(int a, int b, std::vector<char>& source_side) const {
+    validVertex(a);
+    validVertex(b);
+    return flowNetwork()->getMinCut(a, b, source_side);
+}
+
+/**
+ * @brief Returns the residual network of the graph. Every undirected edge becomes one
+ * arc pair with its weight in both directions. Once the graph is frozen the network is
+ * built once and shared by all later calls (concurrent first calls may both build it),
+ * in the graph's memory resource.
+ */
+std::shared_ptr<const MaxFlow> Graph::flowNetwork() const {
+    if (frozen) {
+        if (auto cached = std::atomic_load(&flow_net)) return cached;
+    }
+
+    std::pmr::memory_resource* mr = frozen ? resource : std::pmr::get_default_resource();
+    auto mf = std::allocate_shared<MaxFlow>(std::pmr::polymorphic_allocator<MaxFlow>(mr), num_of_vertex, mr);
+    for (int u = 0; u < num_of_vertex; ++u) {
+        for (const auto& e : neighbors(u)) {
+            if (u < e.dest) mf->addEdge(u, e.dest, e.weight, e.weight);
         }
     }
-    return mf.getMaxFlow(a, b);
+    mf->finalize();
+
+    std::shared_ptr<const MaxFlow> net = std::move(mf);
+    if (frozen) std::atomic_store(&flow_net, net);
+    return net;
 }
 
 /**
  * @brief Returns the neighbors of a vertex.
  * @param v Vertex index
- * @return A reference to the adjacency list of the vertex.
+ * @return A view over the edges of the vertex (CSR slice once the graph is frozen).
  * @throws std::out_of_range if the vertex index is invalid.
  */
-const std::vector<Graph::Edge>& Graph::neighbors(int v) const {
+Graph::EdgeSpan Graph::neighbors(int v) const {
+    validVertex(v);
+    if (frozen) {
+        const Edge* base = csr_edges.data();
+        return EdgeSpan(base + csr_offsets[v], base + csr_offsets[v + 1]);
+    }
+    const auto& list = adj_list[v];
+    return EdgeSpan(list.data(), list.data() + list.size());
+}
+
+/**
+ * @brief Packs the per-vertex adjacency lists into one offsets array and one
+ * contiguous edge array, then releases the lists. Calling it twice is a no-op.
+ */
+void Graph::freeze() {
+    if (frozen) return;
+
+    csr_offsets.assign(num_of_vertex + 1, 0);
+    for (int v = 0; v < num_of_vertex; ++v) {
+        csr_offsets[v + 1] = csr_offsets[v] + adj_list[v].size();
+    }
+
+    csr_edges.reserve(csr_offsets[num_of_vertex]);
+    for (int v = 0; v < num_of_vertex; ++v) {
+        csr_edges.insert(csr_edges.end(), adj_list[v].begin(), adj_list[v].end());
+    }
+
+    std::vector<std::vector<Edge>>().swap(adj_list);// free the scattered blocks
+    frozen = true;
+
+    buildAdjacencyIndex();
+}
+
+/**
+ * @brief Loads a whole edge array into CSR form without going through the adjacency
+ * lists: count the degrees, prefix-sum them into csr_offsets, then scatter every edge
+ * (both directions) into its slot. Each pass is split into blocks run on `threads`
+ * workers; degrees and slots are claimed with relaxed atomic increments. One worker
+ * claims the slots in record order, so the result equals addEdge() + freeze(); with
+ * several the lists are sorted by (dest, weight) afterwards to stay deterministic.
+ * @param edges Edge records, self-loops allowed.
+ * @param threads Number of workers; 0 uses std::thread::hardware_concurrency().
+ * @throws std::out_of_range if a vertex index is invalid.
+ * @throws std::logic_error if the graph already has edges or is frozen.
+ */
+void Graph::bulkLoad(const std::vector<EdgeRecord>& edges, unsigned threads) {
+    if (frozen) {
+        throw std::logic_error("Cannot add edges to a frozen graph");
+    }
+    for (const auto& list : adj_list) {
+        if (!list.empty()) throw std::logic_error("bulkLoad needs a graph without edges");
+    }
+    const size_t n = static_cast<size_t>(num_of_vertex);
+    const size_t m = edges.size();
+    threads = m < BULK_PARALLEL_MIN_EDGES ? 1 : resolveThreads(threads);
+    const size_t blocks = threads * size_t(4);// a few per worker, for balance
+    const size_t vblocks = std::max<size_t>(1, std::min(blocks, n));
+
+    // Degrees; cursor[v] later becomes the next free slot of v's list
+    std::vector<std::atomic<size_t>> cursor(n);
+    std::atomic<bool> bad{false};
+    parallelBlocks(m, blocks, threads, [&](size_t, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            const EdgeRecord& e = edges[i];
+            if (e.src < 0 || e.src >= num_of_vertex || e.dest < 0 || e.dest >= num_of_vertex) {
+                bad.store(true, std::memory_order_relaxed);
+                continue;
+            }
+            cursor[e.src].fetch_add(1, std::memory_order_relaxed);
+            if (e.src != e.dest) cursor[e.dest].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    if (bad.load()) {
+        throw std::out_of_range("Vertex index out of range");
+    }
+
+    // Prefix sum: block totals, their running sum, then each block's offsets
+    std::vector<size_t> base(vblocks + 1, 0);
+    parallelBlocks(n, vblocks, threads, [&](size_t b, size_t lo, size_t hi) {
+        size_t sum = 0;
+        for (size_t v = lo; v < hi; ++v) sum += cursor[v].load(std::memory_order_relaxed);
+        base[b + 1] = sum;
+    });
+    for (size_t b = 0; b < vblocks; ++b) base[b + 1] += base[b];
+    csr_offsets.assign(n + 1, 0);
+    parallelBlocks(n, vblocks, threads, [&](size_t b, size_t lo, size_t hi) {
+        size_t at = base[b];
+        for (size_t v = lo; v < hi; ++v) {
+            csr_offsets[v] = at;
+            at += cursor[v].load(std::memory_order_relaxed);
+            cursor[v].store(csr_offsets[v], std::memory_order_relaxed);
+        }
+    });
+    csr_offsets[n] = base[vblocks];
+
+    // Scatter
+    csr_edges.resize(csr_offsets[n]);
+    parallelBlocks(m, blocks, threads, [&](size_t, size_t lo, size_t hi) {
+        for (size_t i = lo; i < hi; ++i) {
+            const EdgeRecord& e = edges[i];
+            csr_edges[cursor[e.src].fetch_add(1, std::memory_order_relaxed)] = {e.dest, e.weight};
+            if (e.src != e.dest) csr_edges[cursor[e.dest].fetch_add(1, std::memory_order_relaxed)] = {e.src, e.weight};
+        }
+    });
+    if (threads > 1) {// slots were claimed in no particular order
+        parallelBlocks(n, vblocks, threads, [&](size_t, size_t lo, size_t hi) {
+            for (size_t v = lo; v < hi; ++v) {
+                std::sort(csr_edges.begin() + csr_offsets[v], csr_edges.begin() + csr_offsets[v + 1],
+                          [](const Edge& a, const Edge& b) {
+                              return a.dest != b.dest ? a.dest < b.dest : a.weight < b.weight;
+                          });
+            }
+        });
+    }
+
+    std::vector<std::vector<Edge>>().swap(adj_list);
+    frozen = true;
+    buildAdjacencyIndex(threads);
+}
+
+/**
+ * @brief Builds the index behind has_edge(). Small or dense graphs get an n x n bit
+ * matrix; when the matrix would be much larger than the edge array itself, the
+ * CSR lists are sorted by destination instead.
+ * @param threads Workers for the per-vertex passes.
+ */
+void Graph::buildAdjacencyIndex(unsigned threads) {
+    const size_t n = static_cast<size_t>(num_of_vertex);
+    const size_t words = (n + 63) / 64;
+    const size_t matrix_bytes = n * words * sizeof(uint64_t);
+    const size_t edge_bytes = csr_edges.size() * sizeof(Edge);
+
+    if (n <= MATRIX_MAX_VERTICES || matrix_bytes <= MATRIX_EDGE_RATIO * edge_bytes) {
+        row_words = words;
+        adj_bits.assign(n * words, 0);
+        parallelBlocks(n, threads * size_t(4), threads, [&](size_t, size_t lo, size_t hi) {
+            for (size_t u = lo; u < hi; ++u) {// rows are disjoint
+                uint64_t* row = adj_bits.data() + u * words;
+                for (size_t i = csr_offsets[u]; i < csr_offsets[u + 1]; ++i) {
+                    int d = csr_edges[i].dest;
+                    row[d >> 6] |= uint64_t(1) << (d & 63);
+                }
+            }
+        });
+        return;
+    }
+
+    parallelBlocks(n, threads * size_t(4), threads, [&](size_t, size_t lo, size_t hi) {
+        for (size_t u = lo; u < hi; ++u) {
+            std::sort(csr_edges.begin() + csr_offsets[u], csr_edges.begin() + csr_offsets[u + 1],
+                      [](const Edge& a, const Edge& b) { return a.dest < b.dest; });
+        }
+    });
+}
+
+/**
+ * @brief Checks whether u and v are adjacent.
+ * @param u First vertex.
+ * @param v Second vertex.
+ * @return true if there is an edge between u and v.
+ * @throws std::out_of_range if a vertex index is invalid.
+ */
+bool Graph::has_edge(int u, int v) const {
+    validVertex(u);
     validVertex(v);
-    return adj_list[v];
+
+    if (!adj_bits.empty()) {
+        return (adj_bits[u * row_words + (v >> 6)] >> (v & 63)) & 1;
+    }
+
+    if (frozen) {// sorted CSR list
+        EdgeSpan nb = neighbors(u);
+        auto it = std::lower_bound(nb.begin(), nb.end(), v,
+                                   [](const Edge& e, int d) { return e.dest < d; });
+        return it != nb.end() && it->dest == v;
+    }
+
+    // Still building: scan the shorter list
+    const auto& a = adj_list[u].size() <= adj_list[v].size() ? adj_list[u] : adj_list[v];
+    int target = adj_list[u].size() <= adj_list[v].size() ? v : u;
+    for (const auto& e : a) {
+        if (e.dest == target) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the bit-matrix row of a vertex.
+ * @param v Vertex index
+ * @return Pointer to adjacency_row_words() words, or nullptr when no matrix was built.
+ */
+const uint64_t* Graph::adjacency_row(int v) const {
+    validVertex(v);
+    if (adj_bits.empty()) return nullptr;
+    return adj_bits.data() + v * row_words;
+}
+
+/**
+ * @brief Approximates the heap memory held by the graph's current layout.
+ * @return Number of bytes (capacity based, malloc headers not counted).
+ */
+size_t Graph::memory_bytes() const {
+    if (frozen) {
+        return csr_offsets.capacity() * sizeof(size_t) + csr_edges.capacity() * sizeof(Edge)
+             + adj_bits.capacity() * sizeof(uint64_t);
+    }
+    size_t bytes = adj_list.capacity() * sizeof(std::vector<Edge>);
+    for (const auto& list : adj_list) {
+        bytes += list.capacity() * sizeof(Edge);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Bytes the CSR arrays and the adjacency index take once a graph is frozen,
+ * following the same choice of index as buildAdjacencyIndex().
+ * @param n Number of vertices.
+ * @param arcs Adjacency entries (2E for E edges).
+ */
+size_t Graph::frozen_bytes(int n, size_t arcs) {
+    const size_t v = static_cast<size_t>(n);
+    const size_t matrix_bytes = v * ((v + 63) / 64) * sizeof(uint64_t);
+    const size_t edge_bytes = arcs * sizeof(Edge);
+    bool matrix = v <= MATRIX_MAX_VERTICES || matrix_bytes <= MATRIX_EDGE_RATIO * edge_bytes;
+    return (v + 1) * sizeof(size_t) + edge_bytes + (matrix ? matrix_bytes : 0);
 }
   
 } 
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace graph {
+
+namespace {
+
+// Single-writer increment: the owning thread is the only one storing, so no lock prefix is needed
+inline void add(std::atomic<uint64_t>& a, uint64_t d) {
+    a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+}
+
+inline uint64_t micros(Metrics::Clock::duration d) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    return us > 0 ? static_cast<uint64_t>(us) : 0;
+}
+
+// Nominal bucket bounds of the exported Prometheus histograms, in microseconds; each is
+// exported as the upper edge of the histogram bucket holding it, where the count is exact
+constexpr uint64_t PROMETHEUS_BOUNDS[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+                                          250000, 500000, 1000000, 2500000, 5000000, 10000000, 30000000, 60000000};
+
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < SUB_COUNT) return static_cast<size_t>(us);
+    unsigned e = 63 - static_cast<unsigned>(__builtin_clzll(us));// highest set bit, >= SUB_BITS
+    if (e > MAX_EXP) return BUCKETS - 1;
+    size_t group = e - SUB_BITS + 1;
+    return group * SUB_COUNT + static_cast<size_t>((us >> (e - SUB_BITS)) - SUB_COUNT);
+}
+
+uint64_t LatencyHistogram::bucketHigh(size_t b) {
+    if (b < SUB_COUNT) return b;
+    size_t group = b / SUB_COUNT;
+    uint64_t sub = b % SUB_COUNT;
+    unsigned shift = static_cast<unsigned>(group - 1);
+    return ((SUB_COUNT + sub) << shift) + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us) {
+    add(counts[bucketOf(us)], 1);
+    add(total, 1);
+    add(sum, us);
+    if (us > max.load(std::memory_order_relaxed)) max.store(us, std::memory_order_relaxed);
+}
+
+void HistogramSnapshot::add(const LatencyHistogram& h) {
+    for (size_t b = 0; b < counts.size(); ++b) counts[b] += h.counts[b].load(std::memory_order_relaxed);
+    total += h.total.load(std::memory_order_relaxed);
+    sum += h.sum.load(std::memory_order_relaxed);
+    max = std::max(max, h.max.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Reads a percentile off the buckets, as the highest value of the bucket it falls in
+ * (never above the largest value recorded).
+ * @param q Fraction in (0, 1], e.g. 0.99.
+ * @return The percentile in microseconds, 0 if nothing was recorded.
+ */
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (total == 0) return 0;
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts.size(); ++b) {
+        seen += counts[b];
+        if (seen >= target) return std::min(LatencyHistogram::bucketHigh(b), max);
+    }
+    return max;
+}
+
+/**
+ * @brief Counts the values recorded at or below a bound. Exact when us is a bucket's upper
+ * edge (LatencyHistogram::bucketHigh); otherwise the bucket holding us is left out.
+ * @param us The bound in microseconds.
+ * @return The count.
+ */
+uint64_t HistogramSnapshot::countAtMost(uint64_t us) const {
+    uint64_t n = 0;
+    for (size_t b = 0; b < counts.size() && LatencyHistogram::bucketHigh(b) <= us; ++b) n += counts[b];
+    return n;
+}
+
+// Returns the calling thread's shard to the registry when the thread exits
+struct ShardLease {
+    MetricsShard* shard = nullptr;
+    ~ShardLease() {
+        if (shard) Metrics::instance().release(shard);
+    }
+};
+
+Metrics& Metrics::instance() {
+    static Metrics* metrics = new Metrics();// never destroyed: detached workers may still record during exit
+    return *metrics;
+}
+
+MetricsShard& Metrics::local() {
+    thread_local ShardLease lease;
+    if (!lease.shard) {
+        std::lock_guard<std::mutex> lk(m);
+        if (!spare.empty()) {
+            lease.shard = spare.back();
+            spare.pop_back();
+        } else {
+            shards.push_back(std::make_unique<MetricsShard>());
+            lease.shard = shards.back().get();
+        }
+    }
+    return *lease.shard;
+}
+
+void Metrics::release(MetricsShard* shard) {
+    std::lock_guard<std::mutex> lk(m);
+    spare.push_back(shard);
+}
+
+void Metrics::recordWait(size_t stage, Clock::duration waited) {
+    local().stages[stage].wait.record(micros(waited));
+}
+
+void Metrics::recordRun(size_t stage, Clock::duration ran, bool timedOut, bool cancelled) {
+    MetricsShard::Stage& s = local().stages[stage];
+    s.run.record(micros(ran));
+    add(s.runs, 1);
+    if (cancelled) add(s.cancelled, 1);
+    else if (timedOut) add(s.timeouts, 1);
+}
+
+void Metrics::recordNotRun(size_t stage, bool timedOut, bool cancelled) {
+    MetricsShard::Stage& s = local().stages[stage];
+    add(s.runs, 1);
+    if (cancelled) add(s.cancelled, 1);
+    else if (timedOut) add(s.timeouts, 1);
+}
+
+void Metrics::recordCompleted(Clock::duration endToEnd) {
+    MetricsShard& s = local();
+    s.endToEnd.record(micros(endToEnd));
+    add(s.completed, 1);
+}
+
+void Metrics::recordRejected() {
+    add(local().rejected, 1);
+}
+
+/**
+ * @brief Adds up all shards. Counters may move while they are read, so the numbers are
+ * each exact but not necessarily taken at one instant.
+ * @return The totals.
+ */
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot s;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        for (const auto& shard : shards) {
+            for (size_t i = 0; i < s.stages.size(); ++i) {
+                const MetricsShard::Stage& from = shard->stages[i];
+                MetricsSnapshot::Stage& to = s.stages[i];
+                to.wait.add(from.wait);
+                to.run.add(from.run);
+                to.runs += from.runs.load(std::memory_order_relaxed);
+                to.timeouts += from.timeouts.load(std::memory_order_relaxed);
+                to.cancelled += from.cancelled.load(std::memory_order_relaxed);
+            }
+            s.endToEnd.add(shard->endToEnd);
+            s.completed += shard->completed.load(std::memory_order_relaxed);
+            s.rejected += shard->rejected.load(std::memory_order_relaxed);
+        }
+    }
+    s.connections = connections.load(std::memory_order_relaxed);
+    s.uptimeSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+    return s;
+}
+
+namespace {
+
+void writeLatencies(std::ostringstream& out, const HistogramSnapshot& h) {
+    out << " COUNT " << h.total << " P50 " << h.percentile(0.5) << " P90 " << h.percentile(0.9)
+        << " P99 " << h.percentile(0.99) << " P999 " << h.percentile(0.999) << " MAX " << h.max;
+}
+
+size_t depthOf(const QueueDepths& depths, const std::string& name) {
+    for (const auto& [queue, depth] : depths) {
+        if (queue == name) return depth;
+    }
+    return 0;
+}
+
+void writeHelp(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+// Microseconds as exact decimal seconds, e.g. 103 -> 0.000103
+std::string secondsOf(uint64_t us) {
+    std::string s = std::to_string(us / 1000000);
+    uint64_t frac = us % 1000000;
+    if (frac == 0) return s;
+    std::string digits = std::to_string(frac);
+    s += '.' + std::string(6 - digits.size(), '0') + digits;
+    while (s.back() == '0') s.pop_back();
+    return s;
+}
+
+// One histogram series; labels is either empty or a list like stage="MST"
+void writeHistogram(std::ostringstream& out, const char* name, const std::string& labels, const HistogramSnapshot& h) {
+    std::string sep = labels.empty() ? "" : ",";
+    for (uint64_t bound : PROMETHEUS_BOUNDS) {
+        uint64_t edge = LatencyHistogram::bucketHigh(LatencyHistogram::bucketOf(bound));// >= bound, within ~3%
+        out << name << "_bucket{" << labels << sep << "le=\"" << secondsOf(edge) << "\"} " << h.countAtMost(edge) << "\n";
+    }
+    out << name << "_bucket{" << labels << sep << "le=\"+Inf\"} " << h.total << "\n";
+    std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << braces << " " << h.sum / 1e6 << "\n";
+    out << name << "_count" << braces << " " << h.total << "\n";
+}
+
+}
+
+/**
+ * @brief Formats the STATS reply. Latencies are in microseconds.
+ * @param s Metrics snapshot.
+ * @param depths Current queue depths (ThreadPool::queueDepths).
+ * @param cache Result cache counters.
+ * @return The reply, one "OK STATS" line followed by detail lines.
+ */
+std::string formatStats(const MetricsSnapshot& s, const QueueDepths& depths, const ResultCache::Counters& cache) {
+    std::ostringstream out;
+    out << "OK STATS UPTIME_S " << static_cast<uint64_t>(s.uptimeSeconds) << " CONNECTIONS " << s.connections
+        << " COMPLETED " << s.completed << " REJECTED " << s.rejected << "\n";
+    out << "END_TO_END_US";
+    writeLatencies(out, s.endToEnd);
+    out << "\n";
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        const MetricsSnapshot::Stage& st = s.stages[i];
+        out << "STAGE " << AlgorithmFactory::NAMES[i] << " RUNS " << st.runs << " TIMEOUTS " << st.timeouts
+            << " CANCELLED " << st.cancelled << " QUEUED " << depthOf(depths, AlgorithmFactory::NAMES[i]) << "\n";
+        out << "STAGE " << AlgorithmFactory::NAMES[i] << " WAIT_US";
+        writeLatencies(out, st.wait);
+        out << "\nSTAGE " << AlgorithmFactory::NAMES[i] << " RUN_US";
+        writeLatencies(out, st.run);
+        out << "\n";
+    }
+    out << "SINK QUEUED " << depthOf(depths, "SINK") << "\n";
+    out << "CACHE HITS " << cache.hits << " MISSES " << cache.misses << " COALESCED " << cache.coalesced
+        << " EVICTIONS " << cache.evictions << " ENTRIES " << cache.entries << " BYTES " << cache.bytes
+        << " CAPACITY " << cache.capacity << "\n";
+    return out.str();
+}
+
+/**
+ * @brief Formats the STATS PROMETHEUS reply (text exposition format 0.0.4), for a
+ * scraper sidecar. Latencies are exported as histograms in seconds.
+ * @param s Metrics snapshot.
+ * @param depths Current queue depths (ThreadPool::queueDepths).
+ * @param cache Result cache counters.
+ * @return The exposition text.
+ */
+std::string formatPrometheus(const MetricsSnapshot& s, const QueueDepths& depths, const ResultCache::Counters& cache) {
+    std::ostringstream out;
+    writeHelp(out, "graph_uptime_seconds", "gauge", "Seconds since the server started.");
+    out << "graph_uptime_seconds " << s.uptimeSeconds << "\n";
+    writeHelp(out, "graph_connections", "gauge", "Open client connections.");
+    out << "graph_connections " << s.connections << "\n";
+    writeHelp(out, "graph_jobs_completed_total", "counter", "Jobs answered, any outcome.");
+    out << "graph_jobs_completed_total " << s.completed << "\n";
+    writeHelp(out, "graph_jobs_rejected_total", "counter", "Jobs refused by the admission policy.");
+    out << "graph_jobs_rejected_total " << s.rejected << "\n";
+
+    writeHelp(out, "graph_queue_depth", "gauge", "Jobs waiting in front of a stage.");
+    for (const auto& [queue, depth] : depths) out << "graph_queue_depth{queue=\"" << queue << "\"} " << depth << "\n";
+
+    writeHelp(out, "graph_stage_runs_total", "counter", "Jobs taken by a stage.");
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        out << "graph_stage_runs_total{stage=\"" << AlgorithmFactory::NAMES[i] << "\"} " << s.stages[i].runs << "\n";
+    }
+    writeHelp(out, "graph_stage_timeouts_total", "counter", "Stage runs stopped by a deadline or time budget.");
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        out << "graph_stage_timeouts_total{stage=\"" << AlgorithmFactory::NAMES[i] << "\"} " << s.stages[i].timeouts << "\n";
+    }
+    writeHelp(out, "graph_stage_cancelled_total", "counter", "Stage runs stopped because the client left.");
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        out << "graph_stage_cancelled_total{stage=\"" << AlgorithmFactory::NAMES[i] << "\"} " << s.stages[i].cancelled << "\n";
+    }
+
+    writeHelp(out, "graph_stage_queue_wait_seconds", "histogram", "Time a job waited for a stage.");
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        writeHistogram(out, "graph_stage_queue_wait_seconds", std::string("stage=\"") + AlgorithmFactory::NAMES[i] + "\"",
+                       s.stages[i].wait);
+    }
+    writeHelp(out, "graph_stage_run_seconds", "histogram", "Time an algorithm ran on a job.");
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        writeHistogram(out, "graph_stage_run_seconds", std::string("stage=\"") + AlgorithmFactory::NAMES[i] + "\"",
+                       s.stages[i].run);
+    }
+    writeHelp(out, "graph_job_latency_seconds", "histogram", "Time from a parsed request to its response.");
+    writeHistogram(out, "graph_job_latency_seconds", "", s.endToEnd);
+
+    writeHelp(out, "graph_cache_hits_total", "counter", "Requests answered from the result cache.");
+    out << "graph_cache_hits_total " << cache.hits << "\n";
+    writeHelp(out, "graph_cache_misses_total", "counter", "Requests the result cache could not answer.");
+    out << "graph_cache_misses_total " << cache.misses << "\n";
+    writeHelp(out, "graph_cache_coalesced_total", "counter", "Requests that waited for an identical running job.");
+    out << "graph_cache_coalesced_total " << cache.coalesced << "\n";
+    writeHelp(out, "graph_cache_evictions_total", "counter", "Responses evicted from the result cache.");
+    out << "graph_cache_evictions_total " << cache.evictions << "\n";
+    writeHelp(out, "graph_cache_bytes", "gauge", "Bytes held by the result cache.");
+    out << "graph_cache_bytes " << cache.bytes << "\n";
+    return out.str();
+}
+
+}
@@ -1,4 +1,8 @@
 #include "Pipeline.hpp"
+#include "Arena.hpp"
+#include "Metrics.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -11,34 +15,462 @@ namespace graph {
 #define SAFE_COUT(x) do{std::lock_guard<std::mutex> lk(cout_mutex); std::cerr << x << std::endl;} while(0)// safe console output
 
 // ThreadPool constructor: start all pipeline threads
-ThreadPool::ThreadPool() {
-    std::thread(&ThreadPool::stageWorker, this, "MST", std::ref(q_in), std::ref(q_mst)).detach();
-    std::thread(&ThreadPool::stageWorker, this, "MAXFLOW", std::ref(q_mst), std::ref(q_maxflow)).detach();
-    std::thread(&ThreadPool::stageWorker, this, "HAMILTON", std::ref(q_maxflow), std::ref(q_ham)).detach();
-    std::thread(&ThreadPool::stageWorker, this, "MAXCLIQUE", std::ref(q_ham), std::ref(q_clique)).detach();
+ThreadPool::ThreadPool()
+    : q_in(config().queueCapacity), q_mst(config().queueCapacity), q_maxflow(config().queueCapacity),
+      q_ham(config().queueCapacity), q_clique(config().queueCapacity), fanOut(config().fanOut),
+      cache(config().cacheBytes) {
+    const PipelineConfig& cfg = config();
+    const std::pair<const char*, JobQueue*> chain[] = {
+        {"MST", &q_in}, {"MAXFLOW", &q_mst}, {"HAMILTON", &q_maxflow}, {"MAXCLIQUE", &q_ham}};
+    JobQueue* outs[] = {&q_mst, &q_maxflow, &q_ham, &q_clique};
+
+    bool elastic = false;
+    for (size_t i = 0; i < 4; ++i) {
+        auto stage = std::make_unique<Stage>();
+        stage->name = chain[i].first;
+        stage->index = i;
+        stage->in = chain[i].second;
+        stage->out = fanOut ? &q_clique : outs[i];
+        auto it = cfg.stageWorkers.find(stage->name);
+        stage->minWorkers = std::max(1u, it != cfg.stageWorkers.end() ? it->second : cfg.workersPerStage);
+        stage->maxWorkers = std::max(stage->minWorkers, cfg.maxWorkersPerStage);
+        stage->innerThreads = cfg.innerThreads != 0 ? cfg.innerThreads : std::max(1u, resolveThreads(0) / stage->maxWorkers);
+        auto budget = cfg.stageBudgets.find(stage->name);
+        if (budget != cfg.stageBudgets.end()) stage->budget = budget->second;
+        stage->model = AlgorithmFactory::create(stage->name);
+#ifndef PIPELINE_LOCKFREE_QUEUE
+        if (cfg.scheduling == Scheduling::ShortestFirst) stage->in->order(i, cfg.maxOvertakes);
+#endif
+        elastic = elastic || stage->maxWorkers > stage->minWorkers;
+        stages.push_back(std::move(stage));
+    }
+
+    for (auto& stage : stages) {
+        for (unsigned w = 0; w < stage->minWorkers; ++w) startWorker(*stage, false);
+    }
     std::thread(&ThreadPool::sinkWorker, this, std::ref(q_clique)).detach();
+    std::thread(&ThreadPool::expireWorker, this).detach();
+    if (elastic) std::thread(&ThreadPool::monitorWorker, this).detach();
+}
+
+/**
+ * @brief Starts one more detached worker for a stage.
+ * @param stage The stage to serve.
+ * @param elastic Whether the worker may exit again after idleTimeout without jobs.
+ */
+void ThreadPool::startWorker(Stage& stage, bool elastic) {
+    stage.workers.fetch_add(1);
+    std::thread(&ThreadPool::stageWorker, this, std::ref(stage), elastic).detach();
+}
+
+/**
+ * @brief Auto-scaling monitor: adds a worker to every stage whose queue holds more than
+ * backlogPerWorker jobs per current worker, up to maxWorkersPerStage.
+ */
+void ThreadPool::monitorWorker() {
+    const PipelineConfig& cfg = config();
+    while (server_running.load() && !q_in.closed()) {
+        for (auto& stage : stages) {
+            unsigned w = stage->workers.load();
+            if (w < stage->maxWorkers && stage->in->size() > cfg.backlogPerWorker * w) {
+                startWorker(*stage, true);
+                SAFE_COUT("[" << stage->name << "] backlog " << stage->in->size()
+                          << ", scaling up to " << w + 1 << " workers");
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
 }
 
 // Active Object class
 /*
- * @brief Pushes a 'job' into the input queue.
+ * @brief Hands a job to the pipeline, unless the result cache can answer it.
+ * A graph with a cached response completes at once; one identical to a job still in
+ * flight waits for that job's response instead of running again, as long as neither
+ * has a deadline. Under shortest-first scheduling the job's per-stage cost estimates
+ * are computed here.
  * @param job The job to be pushed
+ * @return false if the job was rejected
  */
-void ThreadPool::pushJob(JobPtr job) {
-    q_in.push(std::move(job));
-} 
+bool ThreadPool::pushJob(JobPtr job) {
+    return submit(std::move(job), config().admission);
+}
+
+/*
+ * @brief pushJob() with the admission policy to apply when the entry queue is full.
+ */
+bool ThreadPool::submit(JobPtr job, AdmissionPolicy policy) {
+    if (!prepare(job)) return true;
+    if (enter(job, policy)) return true;
+    refuse(job);
+    return false;
+}
+
+/*
+ * @brief Like pushJob(), but under AdmissionPolicy::Block a full entry queue hands the job
+ * back instead of waiting for room. Its deadline is watched from here on, so a job held
+ * back by the caller still times out.
+ * @param job The job to be pushed.
+ * @return Offer::Full if the caller has to try again with retryJob().
+ */
+ThreadPool::Offer ThreadPool::offerJob(JobPtr job) {
+    if (!prepare(job)) return Offer::Queued;
+    AdmissionPolicy policy = config().admission;
+    bool block = policy == AdmissionPolicy::Block;
+    if (enter(job, block ? AdmissionPolicy::Reject : policy)) return Offer::Queued;
+    if (block) {
+        watchDeadline(job);
+        return Offer::Full;
+    }
+    refuse(job);
+    return Offer::Rejected;
+}
+
+/*
+ * @brief Tries again to queue a job offerJob() returned Full for, without waiting.
+ * @param job The job.
+ * @return Offer::Queued or Offer::Full.
+ */
+ThreadPool::Offer ThreadPool::retryJob(const JobPtr& job) {
+    JobPtr queued = job;
+    return admit(queued, AdmissionPolicy::Reject) ? Offer::Queued : Offer::Full;
+}
+
+/*
+ * @brief Registers a one-shot callback for when a job leaves an entry queue, so a caller
+ * holding jobs back after Offer::Full knows when to retry. It runs on a stage worker and
+ * must not block.
+ * @param wake The callback.
+ */
+void ThreadPool::notifyWhenRoom(std::function<void()> wake) {
+    std::lock_guard<std::mutex> lk(room_mutex);
+    room_waiters.push_back(std::move(wake));
+    room_wanted.store(true);
+}
+
+void ThreadPool::wakeRoomWaiters() {
+    std::vector<std::function<void()>> waiters;
+    {
+        std::lock_guard<std::mutex> lk(room_mutex);
+        waiters.swap(room_waiters);
+        room_wanted.store(false);
+    }
+    if (fanOut) {
+        std::lock_guard<std::mutex> lk(admit_mutex);
+        room_cv.notify_all();
+    }
+    for (auto& wake : waiters) wake();
+}
+
+/*
+ * @brief Sets the job's deadline and looks it up in the result cache; a job that is not
+ * answered or coalesced there gets its per-stage cost estimates.
+ * @param job The job.
+ * @return false if the cache took care of the job.
+ */
+bool ThreadPool::prepare(const JobPtr& job) {
+    std::chrono::milliseconds timeout = config().jobTimeout;
+    if (job->timeout.count() > 0 && (timeout.count() == 0 || job->timeout < timeout)) timeout = job->timeout;
+    if (timeout.count() > 0) job->deadline = std::chrono::steady_clock::now() + timeout;
+
+    if (cache.enabled()) {
+        job->cache_key = cacheKeyOf(*job->g);
+        job->cache_key.options = optionsKeyOf(job->algorithms, job->params);
+        std::string cached;
+        bool coalesce = !job->solo && job->deadline == std::chrono::steady_clock::time_point::max();
+        switch (cache.lookup(job->cache_key, job, cached, coalesce)) {
+        case ResultCache::Lookup::Hit:
+            SAFE_COUT("[CACHE] job " << job->id << " answered from cache");
+            job->result = std::move(cached);
+            completeJob(job);
+            return false;
+        case ResultCache::Lookup::Joined:
+            SAFE_COUT("[CACHE] job " << job->id << " waits for an identical running job");
+            return false;
+        case ResultCache::Lookup::Miss:
+            job->cache_leader = true;
+            break;
+        }
+    }
+
+    if (config().scheduling == Scheduling::ShortestFirst) {// what each stage queue orders by
+        for (auto& stage : stages) {
+            if (job->wants(stage->index)) job->cost[stage->index] = stage->model->cost(*job->g, job->params);
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief admit() plus the deadline watch for a job that got in.
+ * @return false if the job was rejected; it is left untouched then.
+ */
+bool ThreadPool::enter(JobPtr job, AdmissionPolicy policy) {
+    std::weak_ptr<Job> watched = job;// admit() takes the job
+    if (!admit(job, policy)) return false;
+    if (JobPtr queued = watched.lock()) watchDeadline(queued);
+    return true;
+}
+
+/*
+ * @brief Counts a rejected job; the jobs that joined it in the cache meanwhile share the refusal.
+ */
+void ThreadPool::refuse(const JobPtr& job) {
+    Metrics::instance().recordRejected();
+    if (!job->cache_leader) return;
+    for (const JobPtr& follower : cache.finish(job->cache_key, job->id, *job->g, std::string(), false)) {
+        follower->result = "ERR BUSY\n";
+        completeJob(follower);
+    }
+}
+
+/*
+ * @brief Runs a follower on its own after its leader stopped early, whose cut-short
+ * result was meant for the leader alone. It is called from the sink, which must not
+ * wait for room, so a full pipeline answers it ERR BUSY instead.
+ * @param job The follower.
+ */
+void ThreadPool::resubmit(const JobPtr& job) {
+    job->solo = true;
+    AdmissionPolicy policy = config().admission == AdmissionPolicy::Block ? AdmissionPolicy::Reject : config().admission;
+    if (submit(job, policy)) return;
+    job->result = "ERR BUSY\n";
+    completeJob(job);
+}
+
+/*
+ * @brief Pushes a 'job' into the input queue, applying the admission policy when it is full.
+ * Under ShedOldest the dropped job is answered ERR BUSY. In fan-out mode a job enters all the
+ * stage queues it wants or none of them; shedding would leave parts of a job behind in the
+ * other stages, so ShedOldest acts like Reject there. Only Block ever waits.
+ * @param job The job to be pushed; left in place if it is rejected
+ * @param policy What to do when the queue is full.
+ * @return false if the job was rejected
+ */
+bool ThreadPool::admit(JobPtr& job, AdmissionPolicy policy) {
+    job->queued_at = std::chrono::steady_clock::now();
+
+    if (!fanOut) {
+        if (policy == AdmissionPolicy::Reject) return q_in.try_push(job);
+        if (policy == AdmissionPolicy::ShedOldest) {
+            JobPtr shed;
+            if (q_in.push_shed_oldest(std::move(job), shed)) failJob(shed, "ERR BUSY\n");
+            return true;
+        }
+        q_in.push(std::move(job));
+        return true;
+    }
+
+    // Fan-out: only admit() feeds the stage queues, so room found in all of them under
+    // admit_mutex is still there for the pushes; nobody waits while holding it
+    auto roomInAll = [&] {
+        for (auto& stage : stages) {
+            size_t cap = stage->in->capacity();// 0 = unbounded
+            if (job->wants(stage->index) && cap != 0 && stage->in->size() >= cap) return false;
+        }
+        return true;
+    };
+    std::unique_lock<std::mutex> lk(admit_mutex);
+    if (policy == AdmissionPolicy::Block) room_wanted.store(true);// before looking, so no pop goes unnoticed
+    while (!roomInAll()) {
+        if (policy != AdmissionPolicy::Block || q_in.closed()) return false;
+        room_cv.wait_for(lk, ROOM_RETRY);
+        room_wanted.store(true);
+    }
+    job->parts.assign(stages.size(), std::string());// only the requested stages (ALGS) get the job
+    job->parts_expected = 0;
+    for (auto& stage : stages) job->parts_expected += job->wants(stage->index);
+    for (auto& stage : stages) {
+        JobPtr part = job;
+        if (job->wants(stage->index)) stage->in->try_push(part);// only fails once the pipeline is shut down
+    }
+    return true;
+}
+
+/**
+ * @brief Marks a job completed and wakes whoever waits for it; its result must be set.
+ * @param job The job.
+ */
+void ThreadPool::completeJob(const JobPtr& job) {
+    {
+        std::lock_guard<std::mutex> lk(job->job_mutex);
+        job->completed.store(true);
+        job->cv.notify_one();
+    }
+    if (job->on_complete) job->on_complete();// event-loop clients are not waiting on cv
+    Metrics::instance().recordCompleted(std::chrono::steady_clock::now() - job->created);
+}
+
+/**
+ * @brief Completes a job that went through the pipeline (or was dropped from it) and
+ * passes its response on to the result cache and to the jobs coalesced onto it. If a
+ * stage of the job stopped early, the followers run again on their own instead.
+ * @param job The job, with its result set.
+ * @param cacheable Whether the response may be served again for the same graph.
+ */
+void ThreadPool::finishJob(const JobPtr& job, bool cacheable) {
+    completeJob(job);
+    if (!job->cache_leader) return;
+    std::string result;
+    bool stopped;
+    {
+        std::lock_guard<std::mutex> lk(job->job_mutex);
+        result = job->result;
+        stopped = job->stopped_early;
+    }
+    for (const JobPtr& follower : cache.finish(job->cache_key, job->id, *job->g, result, cacheable)) {
+        if (stopped) {
+            resubmit(follower);
+            continue;
+        }
+        follower->result = result;
+        completeJob(follower);
+    }
+}
+
+/**
+ * @brief Cancels a job whose client went away. A job that identical requests have
+ * coalesced onto keeps running for them; otherwise it leaves the cache's in-flight
+ * table, so later identical requests start afresh.
+ * @param job The job.
+ */
+void ThreadPool::cancelJob(const JobPtr& job) {
+    if (job->cache_leader && !cache.abandon(job->cache_key, job->id)) return;
+    job->cancelled.store(true);
+}
+
+/**
+ * @brief Puts a queued job with a deadline under the deadline watch.
+ * @param job The job.
+ */
+void ThreadPool::watchDeadline(const JobPtr& job) {
+    if (job->deadline == std::chrono::steady_clock::time_point::max()) return;
+    std::lock_guard<std::mutex> lk(watch_mutex);
+    bool first = deadlines.empty() || job->deadline < deadlines.begin()->first;
+    deadlines.emplace(job->deadline, job);
+    if (first) watch_cv.notify_one();
+}
+
+/**
+ * @brief Deadline watch: answers the jobs whose deadline passes while they wait in a
+ * queue, so a job stuck behind long runs gets its ERR TIMEOUT on time. A job a stage is
+ * running is left to that stage, which polls the same deadline, and looked at again.
+ */
+void ThreadPool::expireWorker() {
+    std::unique_lock<std::mutex> lk(watch_mutex);
+    while (server_running.load()) {
+        if (deadlines.empty()) {
+            watch_cv.wait_for(lk, std::chrono::seconds(1));
+            continue;
+        }
+        auto first = deadlines.begin();
+        auto now = std::chrono::steady_clock::now();
+        if (now < first->first) {
+            watch_cv.wait_until(lk, first->first);
+            continue;
+        }
+        std::weak_ptr<Job> weak = std::move(first->second);
+        deadlines.erase(first);
+        lk.unlock();
+        JobPtr job = weak.lock();// gone once it was answered and delivered
+        bool done = !job || expireJob(job);
+        lk.lock();
+        if (!done) deadlines.emplace(now + EXPIRE_RETRY, std::move(weak));
+    }
+}
+
+/**
+ * @brief Answers a job whose deadline has passed: the parts its stages added so far, and
+ * ERR TIMEOUT for every requested stage that has not run. The stages drop it afterwards.
+ * @param job The job.
+ * @return false if a stage is running the job, true once it is answered (by anyone).
+ */
+bool ThreadPool::expireJob(const JobPtr& job) {
+    {
+        std::lock_guard<std::mutex> lk(job->job_mutex);
+        if (job->running > 0) return false;
+        if (job->answered.exchange(true)) return true;
+        std::string response = fanOut ? std::string() : std::move(job->result);// serial: the finished stages, in order
+        for (const auto& stage : stages) {
+            if (!job->wants(stage->index)) continue;
+            if ((job->stages_done >> stage->index) & 1u) {
+                if (fanOut) response += job->parts[stage->index];
+                continue;
+            }
+            response += "ERR TIMEOUT " + stage->name + "\n";
+            Metrics::instance().recordNotRun(stage->index, true, false);
+        }
+        job->result = std::move(response);
+    }
+    SAFE_COUT("[DEADLINE] job " << job->id << " expired while queued");
+    finishJob(job, false);
+    return true;
+}
+
+/**
+ * @brief Completes a job that never went through the stages, e.g. one shed under load.
+ * @param job The job.
+ * @param message Full response for the job's client.
+ */
+void ThreadPool::failJob(const JobPtr& job, const std::string& message) {
+    if (job->answered.exchange(true)) return;// the deadline watch was first
+    {
+        std::lock_guard<std::mutex> lk(job->job_mutex);
+        job->result = message;
+    }
+    finishJob(job, false);
+}
+
+/**
+ * @brief Reports how many jobs wait in front of each stage, for load balancers to back off.
+ * @return (stage name, queue depth) pairs in pipeline order, the sink last.
+ */
+std::vector<std::pair<std::string, size_t>> ThreadPool::queueDepths() const {
+    std::vector<std::pair<std::string, size_t>> depths;
+    for (const auto& stage : stages) depths.emplace_back(stage->name, stage->in->size());
+    depths.emplace_back("SINK", q_clique.size());
+    return depths;
+}
 
 /**
- * @brief Stage worker function that processes jobs for a specific algorithm
- * @param algName Name of the algorithm to process.
- * @param in Input job queue
- * @param out Output job queue.
+ * @brief Stage worker function that processes jobs for a specific algorithm.
+ * Several workers may serve one stage; each job still visits the stages in order, and
+ * a stage the job did not ask for (ALGS) only forwards it.
+ * @param stage The stage (algorithm name, input and output queues).
+ * @param elastic Whether this worker was added by the monitor and may exit when idle.
  */
-void ThreadPool::stageWorker(const std::string& algName, BlockingQueue<JobPtr>& in, BlockingQueue<JobPtr>& out) {
-    auto alg = AlgorithmFactory::create(algName);//create algorithm instance
+void ThreadPool::stageWorker(Stage& stage, bool elastic) {
+    const std::string& algName = stage.name;
+    auto alg = AlgorithmFactory::create(algName);//create algorithm instance (one per worker)
+    if (alg) alg->threads = stage.innerThreads;
+    const auto idle = elastic ? config().idleTimeout : std::chrono::milliseconds(1000);
     while (server_running.load()) {
-        JobPtr job = in.pop();//get job from input queue
-        if(!job) break;//new
+        JobPtr job;
+        if (!stage.in->pop_for(job, idle)) {//get job from input queue
+            if (stage.in->closed()) break;
+            if (elastic) {// idle extra worker: leave unless that would drop below minWorkers
+                unsigned w = stage.workers.load();
+                while (w > stage.minWorkers && !stage.workers.compare_exchange_weak(w, w - 1)) {}
+                if (w > stage.minWorkers) return;
+            }
+            continue;
+        }
+
+        if ((fanOut || stage.index == 0) && room_wanted.load()) wakeRoomWaiters();// left an entry queue
+
+        {
+            std::lock_guard<std::mutex> lk(job->job_mutex);
+            if (job->answered.load()) continue;// expired while queued and already answered: drop it
+            if (job->wants(stage.index)) ++job->running;
+        }
+        if (!job->wants(stage.index)) {// not requested (ALGS): pass through untouched
+            job->queued_at = std::chrono::steady_clock::now();
+            stage.out->push(std::move(job));
+            continue;
+        }
+        Metrics& metrics = Metrics::instance();
+        auto started = std::chrono::steady_clock::now();
+        metrics.recordWait(stage.index, started - job->queued_at);
 
         {// Print to see that the Job has been taken and is being worked on
             std::lock_guard<std::mutex> lk(cout_mutex);
@@ -46,49 +478,90 @@ void ThreadPool::stageWorker(const std::string& algName, BlockingQueue<JobPtr>&
                       << " on thread " << std::this_thread::get_id() << std::endl;
         }
 
-        // Run the algorithm on the job's graph
+        // Run the algorithm on the job's graph, within the job's deadline and the stage's budget
+        auto deadline = job->deadline;
+        if (stage.budget.count() > 0) deadline = std::min(deadline, started + stage.budget);
+        CancelToken cancel(&job->cancelled, deadline);
         std::string result_part;
-        if (alg) {
-            result_part = alg->run(*job->g);
+        bool ran = false, failed = false, stopped = true;
+        if (cancel.cancelled()) {
+            result_part = "ERR CANCELLED " + algName + "\n";
+        }
+        else if (cancel.expired()) {// the deadline passed while the job was queued
+            result_part = "ERR TIMEOUT " + algName + "\n";
+        }
+        else if (alg) {
+            ScratchScope scope;// the run's temporaries come from this worker's arena and go in one step
+            alg->stopped = false;
+            try {
+                result_part = alg->run(*job->g, job->params, cancel);
+            } catch (const std::exception& e) {// e.g. bad_alloc: fails this job, not the server
+                result_part = "ERR EXCEPTION " + algName + ": " + e.what() + "\n";
+                failed = true;
+            } catch (...) {
+                result_part = "ERR EXCEPTION " + algName + "\n";
+                failed = true;
+            }
+            ran = true;
+            stopped = alg->stopped;// the algorithm knows whether it gave up or just finished late
         } 
         else {
             result_part = "ERR UNKNOWN ALGORITHM " + algName + "\n";
+            stopped = false;
         }
+        bool cancelled = stopped && cancel.cancelled();
+        if (ran) metrics.recordRun(stage.index, std::chrono::steady_clock::now() - started, stopped && !cancelled, cancelled);
+        else metrics.recordNotRun(stage.index, stopped && !cancelled, cancelled);
         
         // Protect access to shared result
         {
             std::lock_guard<std::mutex> lk(job->job_mutex);//lock_guard is used to protect access to job data
-            job->result += result_part;
+            if (fanOut) job->parts[stage.index] = std::move(result_part);
+            else job->result += result_part;
+            job->stopped_early = job->stopped_early || stopped || failed;// neither is cached
+            job->stages_done |= 1u << stage.index;
+            --job->running;
         }
 
         // Lock before writing to result
         {
             std::lock_guard<std::mutex> lk(cout_mutex);
             std::cerr << "[" << algName << "] job " << job->id
-                      << " moving to next stage " << std::endl;
+                      << (fanOut ? " part done " : " moving to next stage ") << std::endl;
         }
 
-        out.push(std::move(job));//push job to output queue
+        if (!fanOut) job->queued_at = std::chrono::steady_clock::now();// fan-out: the stages share one job
+        stage.out->push(std::move(job));//push job to output queue
     }
+    stage.workers.fetch_sub(1);
 }
 
 /**
- * @brief Sink worker function that processes completed jobs
+ * @brief Sink worker function that processes completed jobs (and joins the parts in fan-out mode)
  * @param in Input job queue.
  */
-void ThreadPool::sinkWorker(BlockingQueue<JobPtr>& in) {
+void ThreadPool::sinkWorker(JobQueue& in) {
         while (server_running.load()) {
 
             JobPtr job = in.pop();
             if(!job) break;//new
 
+            // Fan-out mode: the sink is the join, a job is done when its last part arrives
+            if (fanOut && ++job->parts_done < job->parts_expected) continue;
+            if (job->answered.exchange(true)) continue;// the deadline watch answered it
+
             SAFE_COUT("sinkWorker: processing job " << job->id);//safe console output
 
-            {
+            if (fanOut) {
                 std::lock_guard<std::mutex> lk(job->job_mutex);//lock_guard is used to protect access to job data
-                job->completed.store(true);// mark job as completed
-                job->cv.notify_one();// notify waiting threads
+                for (const auto& part : job->parts) job->result += part;// canonical stage order
+            }
+            bool cacheable;
+            {
+                std::lock_guard<std::mutex> lk(job->job_mutex);
+                cacheable = !job->stopped_early;
             }
+            finishJob(job, cacheable);// mark job as completed, notify waiting threads and coalesced jobs
             SAFE_COUT("sinkWorker: notified job " << job->id);
         }
     }
@@ -0,0 +1,329 @@
+#include "RandomGraph.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+namespace {
+
+using EdgeRecord = Graph::EdgeRecord;
+using EdgeBlocks = std::vector<std::vector<EdgeRecord>>;
+
+constexpr double MAX_RANDOM_EDGES = INT_MAX;// what the E line of a GRAPH request can carry
+constexpr double EDGES_PER_BLOCK = 16384;// generation work unit
+constexpr size_t MAX_BLOCKS = 256;
+
+// Stream ids of the generation phases, so no two phases draw the same numbers
+constexpr uint64_t PHASE_SELECT = uint64_t(1) << 40, PHASE_POINTS = uint64_t(2) << 40;
+
+double pairCount(int n) { return 0.5 * n * (static_cast<double>(n) - 1); }
+
+inline uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Counter-based generator (SplitMix64 over a counter): output k of stream s depends only
+ * on (seed, s, k), so the blocks of a graph can be generated on any thread, in any order,
+ * with the same result. Draws are done here rather than through <random> distributions,
+ * whose output differs between standard libraries.
+ */
+class StreamRng {
+public:
+    StreamRng(uint64_t seed, uint64_t stream) : key(mix(seed + mix(stream + 0x9e3779b97f4a7c15ULL))) {}
+
+    uint64_t next() { return mix(key + 0x9e3779b97f4a7c15ULL * ++counter); }
+    double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }// [0, 1)
+    uint64_t below(uint64_t n) { return static_cast<uint64_t>((static_cast<unsigned __int128>(next()) * n) >> 64); }
+    int weight() { return 1 + static_cast<int>(below(10)); }// 1..10
+
+private:
+    uint64_t key;
+    uint64_t counter = 0;
+};
+
+// Blocks for about `edges` edges: a function of the request only, never of the thread count
+size_t blocksFor(double edges) {
+    return static_cast<size_t>(std::clamp(edges / EDGES_PER_BLOCK, 1.0, static_cast<double>(MAX_BLOCKS)));
+}
+
+// First row of block b when rows 1..n-1 (row v holds the v pairs (v, w < v)) are cut into
+// `blocks` parts with about the same number of pairs
+int rowSplit(int n, size_t b, size_t blocks) {
+    if (b == 0) return 1;
+    if (b >= blocks) return n;
+    int v = static_cast<int>(std::ceil(n * std::sqrt(static_cast<double>(b) / static_cast<double>(blocks))));
+    return std::clamp(v, 1, n);
+}
+
+// Concatenates the blocks in order, copying them in parallel
+std::vector<EdgeRecord> concat(EdgeBlocks& parts, unsigned threads) {
+    std::vector<size_t> at(parts.size() + 1, 0);
+    for (size_t b = 0; b < parts.size(); ++b) at[b + 1] = at[b] + parts[b].size();
+    std::vector<EdgeRecord> out(at.back());
+    parallelFor(parts.size(), threads, [&](size_t b) {
+        std::copy(parts[b].begin(), parts[b].end(), out.begin() + static_cast<std::ptrdiff_t>(at[b]));
+        std::vector<EdgeRecord>().swap(parts[b]);
+    });
+    return out;
+}
+
+/**
+ * @brief G(n,p) on rows [lo, hi) by geometric skipping (Batagelj and Brandes): the gap to
+ * the next chosen pair is drawn directly, so the cost is O(rows + edges) instead of O(n^2).
+ * Pairs come out as (v, w) with w < v, ordered by v, then w.
+ */
+template<typename Emit>
+void gnpRows(int lo, int hi, double p, StreamRng& rng, Emit&& emit) {
+    if (p <= 0) return;
+    if (p >= 1) {
+        for (int v = lo; v < hi; ++v) {
+            for (int w = 0; w < v; ++w) emit(v, w);
+        }
+        return;
+    }
+    const double logq = std::log1p(-p);
+    long long v = lo, w = -1;
+    while (v < hi) {
+        double skip = std::floor(std::log1p(-rng.unit()) / logq);
+        w += 1 + static_cast<long long>(std::min(skip, 4e18));
+        while (w >= v && v < hi) {
+            w -= v;
+            ++v;
+        }
+        if (v < hi) emit(static_cast<int>(v), static_cast<int>(w));
+    }
+}
+
+// G(n,p) cut into row blocks, one stream per block (streamBase + b)
+EdgeBlocks gnpBlocks(int n, double p, uint64_t seed, uint64_t streamBase, unsigned threads) {
+    const size_t blocks = n < 2 ? 1 : blocksFor(p * pairCount(n));
+    EdgeBlocks parts(blocks);
+    parallelFor(blocks, threads, [&](size_t b) {
+        StreamRng rng(seed, streamBase + b);
+        parts[b].reserve(static_cast<size_t>(p * (pairCount(rowSplit(n, b + 1, blocks)) - pairCount(rowSplit(n, b, blocks)))));
+        gnpRows(rowSplit(n, b, blocks), rowSplit(n, b + 1, blocks), p, rng,
+                [&](int v, int w) { parts[b].push_back({v, w, rng.weight()}); });
+    });
+    return parts;
+}
+
+/**
+ * @brief m distinct pairs with weights, uniform over all m-subsets, in gnpRows() order.
+ * Oversamples with G(n,p) for p a few standard deviations above m/N (in parallel), then
+ * keeps m of the candidates by selection sampling: a uniform subset of a uniform subset
+ * is uniform. O(m) expected for m <= N/2; the rare short draw is repeated on new streams.
+ */
+std::vector<EdgeRecord> samplePairs(int n, long long m, uint64_t seed, unsigned threads) {
+    std::vector<EdgeRecord> pairs;
+    if (m <= 0) return pairs;
+    const double slack = 4 * std::sqrt(static_cast<double>(m)) + 16;
+    const double p = std::min(1.0, (static_cast<double>(m) + slack) / pairCount(n));
+    for (uint64_t attempt = 0; static_cast<long long>(pairs.size()) < m; ++attempt) {
+        EdgeBlocks parts = gnpBlocks(n, p, seed, attempt * MAX_BLOCKS, threads);
+        pairs = concat(parts, threads);
+    }
+
+    StreamRng rng(seed, PHASE_SELECT);
+    size_t need = static_cast<size_t>(m), left = pairs.size(), kept = 0;
+    for (size_t i = 0; need > 0; ++i, --left) {// Knuth's algorithm S, keeps the order
+        if (rng.below(left) < need) {
+            pairs[kept++] = pairs[i];
+            --need;
+        }
+    }
+    pairs.resize(kept);
+    return pairs;
+}
+
+std::vector<EdgeRecord> gnm(int n, long long m, uint64_t seed, unsigned threads) {
+    const double total = pairCount(n);
+    if (static_cast<double>(m) <= total / 2) return samplePairs(n, m, seed, threads);
+
+    // Dense: draw the pairs to leave out instead, then walk all pairs in the same order
+    const std::vector<EdgeRecord> excluded = samplePairs(n, static_cast<long long>(total) - m, seed, threads);
+    const size_t blocks = blocksFor(static_cast<double>(m));
+    EdgeBlocks parts(blocks);
+    parallelFor(blocks, threads, [&](size_t b) {
+        StreamRng rng(seed, PHASE_POINTS + b);
+        const int lo = rowSplit(n, b, blocks), hi = rowSplit(n, b + 1, blocks);
+        auto x = std::lower_bound(excluded.begin(), excluded.end(), lo,
+                                  [](const EdgeRecord& e, int row) { return e.src < row; });
+        for (int v = lo; v < hi; ++v) {
+            for (int w = 0; w < v; ++w) {
+                if (x != excluded.end() && x->src == v && x->dest == w) {
+                    ++x;
+                    continue;
+                }
+                parts[b].push_back({v, w, rng.weight()});
+            }
+        }
+    });
+    return concat(parts, threads);
+}
+
+// Linear-time preferential attachment: a vertex is picked with probability proportional
+// to its degree by drawing a uniform entry of the list of all edge endpoints. Each new
+// vertex depends on all earlier ones, so this model stays on one thread
+std::vector<EdgeRecord> barabasiAlbert(int n, int k, uint64_t seed) {
+    StreamRng rng(seed, 0);
+    std::vector<EdgeRecord> edges;
+    edges.reserve(static_cast<size_t>(n) * static_cast<size_t>(k));
+    std::vector<int> ends;
+    ends.reserve(2 * static_cast<size_t>(n) * static_cast<size_t>(k));
+    const int core = std::min(n, k + 1);// starts as a clique, so every vertex has k distinct choices
+    for (int v = 1; v < core; ++v) {
+        for (int w = 0; w < v; ++w) {
+            edges.push_back({v, w, rng.weight()});
+            ends.push_back(v);
+            ends.push_back(w);
+        }
+    }
+    std::vector<int> picks;
+    picks.reserve(static_cast<size_t>(k));
+    for (int v = core; v < n; ++v) {
+        picks.clear();
+        while (static_cast<int>(picks.size()) < k) {
+            int t = ends[rng.below(ends.size())];
+            if (std::find(picks.begin(), picks.end(), t) == picks.end()) picks.push_back(t);
+        }
+        for (int t : picks) {
+            edges.push_back({v, t, rng.weight()});
+            ends.push_back(v);
+            ends.push_back(t);
+        }
+    }
+    return edges;
+}
+
+std::vector<EdgeRecord> grid(int n, int width, uint64_t seed, unsigned threads) {
+    const size_t blocks = blocksFor(2.0 * n);
+    EdgeBlocks parts(blocks);
+    parallelBlocks(static_cast<size_t>(n), blocks, threads, [&](size_t b, size_t lo, size_t hi) {
+        StreamRng rng(seed, b);
+        for (int i = static_cast<int>(lo); i < static_cast<int>(hi); ++i) {
+            if ((i + 1) % width != 0 && i + 1 < n) parts[b].push_back({i, i + 1, rng.weight()});
+            if (i < n - width) parts[b].push_back({i, i + width, rng.weight()});
+        }
+    });
+    return concat(parts, threads);
+}
+
+// Points are bucketed into square cells at least `radius` wide, so only the 3x3 block of
+// cells around a point can hold its neighbours
+std::vector<EdgeRecord> geometric(int n, double radius, uint64_t seed, unsigned threads) {
+    const size_t count = static_cast<size_t>(n);
+    std::vector<double> x(count), y(count);
+    parallelBlocks(count, blocksFor(static_cast<double>(n)), threads, [&](size_t b, size_t lo, size_t hi) {
+        StreamRng rng(seed, PHASE_POINTS + b);
+        for (size_t i = lo; i < hi; ++i) {
+            x[i] = rng.unit();
+            y[i] = rng.unit();
+        }
+    });
+    if (radius <= 0) return {};
+
+    const int maxSide = static_cast<int>(std::sqrt(static_cast<double>(n))) + 1;// about one point per cell at most
+    const int side = 1 / radius >= maxSide ? maxSide : std::max(1, static_cast<int>(1 / radius));
+    auto cellOf = [&](double c) { return std::min(side - 1, static_cast<int>(c * side)); };
+
+    // Counting sort of the points by cell: cell c holds order[start[c] .. start[c+1])
+    std::vector<int> start(static_cast<size_t>(side) * side + 1, 0), order(count);
+    for (size_t i = 0; i < count; ++i) ++start[cellOf(y[i]) * side + cellOf(x[i]) + 1];
+    for (size_t c = 1; c < start.size(); ++c) start[c] += start[c - 1];
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < count; ++i) order[fill[cellOf(y[i]) * side + cellOf(x[i])]++] = static_cast<int>(i);
+
+    const double r2 = radius * radius;
+    const size_t blocks = blocksFor(std::min(1.0, M_PI * r2) * pairCount(n));
+    EdgeBlocks parts(blocks);
+    parallelBlocks(count, blocks, threads, [&](size_t b, size_t lo, size_t hi) {
+        StreamRng rng(seed, b);
+        for (int i = static_cast<int>(lo); i < static_cast<int>(hi); ++i) {
+            int cx = cellOf(x[i]), cy = cellOf(y[i]);
+            for (int ny = std::max(0, cy - 1); ny <= std::min(side - 1, cy + 1); ++ny) {
+                for (int nx = std::max(0, cx - 1); nx <= std::min(side - 1, cx + 1); ++nx) {
+                    int c = ny * side + nx;
+                    for (int k = start[c]; k < start[c + 1]; ++k) {
+                        int j = order[k];
+                        if (j <= i) continue;// each pair once
+                        double dx = x[i] - x[j], dy = y[i] - y[j];
+                        if (dx * dx + dy * dy <= r2) parts[b].push_back({i, j, rng.weight()});
+                    }
+                }
+            }
+        }
+    });
+    return concat(parts, threads);
+}
+
+}
+
+/**
+ * @brief Checks a RANDOM request's parameters before any memory is spent on it.
+ * @param spec The request.
+ * @return nullptr if it can be generated, else the message for ERR PARSE_FAILED.
+ */
+const char* validateRandomSpec(const RandomGraphSpec& spec) {
+    const int n = spec.vertices;
+    const double pairs = pairCount(n);
+    switch (spec.model) {
+    case RandomModel::Gnm:
+        if (static_cast<double>(spec.edges) > pairs) return "more edges than vertex pairs";
+        return nullptr;
+    case RandomModel::Gnp:
+        if (!(spec.probability >= 0 && spec.probability <= 1)) return "invalid edge probability";
+        if (spec.probability * pairs > MAX_RANDOM_EDGES) return "random graph too large";
+        return nullptr;
+    case RandomModel::BarabasiAlbert:
+        if (spec.attach < 1 || spec.attach >= n) return "invalid attachment count";
+        if (static_cast<double>(spec.attach) * n > MAX_RANDOM_EDGES) return "random graph too large";
+        return nullptr;
+    case RandomModel::Grid:
+        if (spec.width < 1) return "invalid grid width";
+        return nullptr;
+    case RandomModel::Geometric:
+        if (!(spec.radius >= 0)) return "invalid radius";
+        if (std::min(1.0, M_PI * spec.radius * spec.radius) * pairs > MAX_RANDOM_EDGES) return "random graph too large";
+        return nullptr;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Generates a random graph into an edge array, block by block on `threads`
+ * workers, and bulk-loads it into G. No duplicate checks are needed: every model
+ * produces each pair at most once by construction.
+ * @param G Empty graph with spec.vertices vertices.
+ * @param spec Model and parameters, already checked by validateRandomSpec().
+ * @param threads Number of workers; 0 uses std::thread::hardware_concurrency().
+ */
+void generateRandomGraph(Graph& G, const RandomGraphSpec& spec, unsigned threads) {
+    thread_local std::mt19937_64 seeder(std::random_device{}());// only for requests without SEED
+    const uint64_t seed = spec.seed ? *spec.seed : seeder();
+    threads = resolveThreads(threads);
+    const int n = spec.vertices;
+
+    std::vector<EdgeRecord> edges;
+    switch (spec.model) {
+    case RandomModel::Gnm: edges = gnm(n, spec.edges, seed, threads); break;
+    case RandomModel::Gnp: {
+        EdgeBlocks parts = gnpBlocks(n, spec.probability, seed, 0, threads);
+        edges = concat(parts, threads);
+        break;
+    }
+    case RandomModel::BarabasiAlbert: edges = barabasiAlbert(n, spec.attach, seed); break;
+    case RandomModel::Grid: edges = grid(n, spec.width, seed, threads); break;
+    case RandomModel::Geometric: edges = geometric(n, spec.radius, seed, threads); break;
+    }
+    G.bulkLoad(edges, threads);
+}
+
+}
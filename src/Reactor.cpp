@@ -0,0 +1,400 @@
+#include "Reactor.hpp"
+#include "Metrics.hpp"
+#include "server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+
+namespace graph {
+
+Reactor::Mailbox::~Mailbox() {
+    if (efd >= 0) ::close(efd);
+}
+
+void Reactor::Mailbox::post(uint64_t conn, size_t job) {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        ready.emplace_back(conn, job);
+    }
+    wake();
+}
+
+void Reactor::Mailbox::park(uint64_t conn, JobPtr job) {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        full.emplace_back(conn, std::move(job));
+    }
+    wake();
+}
+
+void Reactor::Mailbox::roomFreed() {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        room = true;
+    }
+    wake();
+}
+
+void Reactor::Mailbox::wake() {
+    uint64_t one = 1;
+    ssize_t n = ::write(efd, &one, sizeof(one));// only fails if the counter would overflow: still readable then
+    (void)n;
+}
+
+Reactor::~Reactor() {
+    builds.close();// the builder finishes what is queued; offering a job never waits
+    if (builder.joinable()) builder.join();
+    for (auto& [id, c] : conns) ::close(c.fd);
+    if (epfd >= 0) ::close(epfd);
+    if (lfd >= 0) ::close(lfd);
+}
+
+/**
+ * @brief Creates the non-blocking listening socket, the epoll instance and the wakeup eventfd.
+ * @param port TCP port, shared with the other reactors through SO_REUSEPORT.
+ * @param backlog listen() backlog.
+ * @return true on success.
+ */
+bool Reactor::open(int port, int backlog) {
+    lfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (lfd < 0) { perror("socket"); return false; }
+
+    int opt = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));// one accept queue per reactor
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(lfd, (sockaddr*)&addr, sizeof(addr)) < 0) { perror("bind"); return false; }
+    if (listen(lfd, backlog) < 0) { perror("listen"); return false; }
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) { perror("epoll_create1"); return false; }
+
+    mailbox = std::make_shared<Mailbox>();
+    mailbox->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mailbox->efd < 0) { perror("eventfd"); return false; }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = LISTEN_ID;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev) < 0) { perror("epoll_ctl"); return false; }
+    ev.data.u64 = WAKE_ID;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, mailbox->efd, &ev) < 0) { perror("epoll_ctl"); return false; }
+
+    builder = std::thread([this] {
+        while (auto build = builds.pop()) build();
+    });
+    return true;
+}
+
+/**
+ * @brief Event loop: accepts, reads and writes until running turns false.
+ * The 1 second wait timeout bounds how long shutdown takes to be noticed.
+ * @param running Server status flag.
+ */
+void Reactor::run(const std::atomic<bool>& running) {
+    epoll_event events[MAX_EVENTS];
+    while (running.load()) {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            uint64_t id = events[i].data.u64;
+            uint32_t ev = events[i].events;
+            if (id == LISTEN_ID) {
+                acceptAll();
+            } else if (id == WAKE_ID) {
+                deliverCompleted();
+            } else {
+                if (ev & (EPOLLHUP | EPOLLERR)) {// client went away: its running jobs are cancelled
+                    drop(id);
+                    continue;
+                }
+                if (ev & (EPOLLIN | EPOLLRDHUP)) readFrom(id);
+                if (ev & EPOLLOUT) flush(id);
+            }
+        }
+    }
+}
+
+// Accepts every pending connection (edge-triggered: until EAGAIN)
+void Reactor::acceptAll() {
+    while (true) {
+        int cfd = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        uint64_t id = next_id++;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;// EPOLLOUT only fires on edges, so it costs nothing while idle
+        ev.data.u64 = id;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &ev) < 0) {
+            perror("epoll_ctl");
+            ::close(cfd);
+            continue;
+        }
+        conns[id].fd = cfd;
+        Metrics::instance().connectionOpened();
+    }
+}
+
+// Reads what is available and starts every request that is complete
+void Reactor::readFrom(uint64_t id) {
+    auto it = conns.find(id);
+    if (it == conns.end()) return;
+    Connection& c = it->second;
+    if (c.eof) return;// nothing more is read from this client
+    if (c.parked > 0) return;// back-pressure: the socket fills up until the pipeline takes the parked jobs
+
+    char buf[4096];
+    while (true) {
+        ssize_t n = ::read(c.fd, buf, sizeof(buf));
+        if (n > 0) {
+            if (c.parser) c.parser->feed(std::string_view(buf, static_cast<size_t>(n)));
+            else c.in.append(buf, buf + n);
+        } else if (n == 0) {
+            c.eof = true;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            drop(id);// connection broken: nobody left to answer
+            return;
+        }
+    }
+    parseInput(id, c);
+    flush(id);
+}
+
+// Splits the buffered input into requests: one per connection in plain mode, one per frame in framed mode
+void Reactor::parseInput(uint64_t id, Connection& c) {
+    if (c.mode == Mode::Unknown) {
+        if (c.in.size() >= FRAMED_HELLO.size() && couldBeFramed(c.in)) {
+            c.mode = Mode::Framed;
+            c.in.erase(0, FRAMED_HELLO.size());
+        } else if (!couldBeFramed(c.in) || c.eof) {
+            c.mode = Mode::Plain;
+            c.parser = std::make_unique<RequestParser>();
+            c.parser->feed(c.in);
+            std::string().swap(c.in);
+        } else {
+            return;// too short to tell yet
+        }
+    }
+
+    if (c.mode == Mode::Plain) {
+        if (!c.eof || !c.parser) return;// the request ends with the client's half-close
+        startRequest(id, c, "", std::move(c.parser));
+        return;
+    }
+
+    size_t pos = 0;
+    std::string tag;
+    std::string_view req;
+    FrameStatus st;
+    while (c.parked == 0 && (st = takeFrame(c.in, pos, tag, req)) == FrameStatus::Frame) {
+        auto parser = std::make_shared<RequestParser>();
+        parser->feed(req);
+        startRequest(id, c, tag, std::move(parser));
+    }
+    c.in.erase(0, pos);
+    if (c.parked > 0) return;// the rest waits until the pipeline has room
+    if (st == FrameStatus::Bad) {// can't resynchronise: answer what is in flight, then close
+        c.in.clear();
+        c.eof = true;
+        respond(c, "-", "ERR PARSE_FAILED: bad frame header\n");
+    }
+}
+
+// Ends one request and either answers it right away or has the builder submit its job
+void Reactor::startRequest(uint64_t id, Connection& c, const std::string& tag, std::shared_ptr<RequestParser> parser) {
+    JobPtr job;
+    std::string reply;
+    if (!parser->prepare(job, reply)) {
+        respond(c, tag, reply);
+        return;
+    }
+
+    std::shared_ptr<Mailbox> box = mailbox;
+    size_t jobId = job->id;
+    job->on_complete = [box, id, jobId] { box->post(id, jobId); };
+    c.jobs[jobId] = Pending{tag, job};
+    builds.push([box, id, parser, job] { buildJob(box, id, *parser, job); });
+}
+
+/**
+ * @brief Builder thread: loads or generates the job's graph and offers the job to the
+ * pipeline. Failures and refusals are posted back like finished jobs; a job that finds
+ * the pipeline full under AdmissionPolicy::Block goes back to be parked.
+ * @param box The reactor's mailbox.
+ * @param id Connection id.
+ * @param parser The request, prepared.
+ * @param job The job it made.
+ */
+void Reactor::buildJob(const std::shared_ptr<Mailbox>& box, uint64_t id, RequestParser& parser, const JobPtr& job) {
+    if (job->cancelled.load()) return;// the client went away meanwhile
+
+    std::string reply;
+    if (parser.build(*job, reply)) {
+        switch (getThreadPool().offerJob(job)) {
+        case ThreadPool::Offer::Queued: return;// on_complete posts it
+        case ThreadPool::Offer::Full: box->park(id, job); return;
+        case ThreadPool::Offer::Rejected: reply = "ERR BUSY\n"; break;// the client may retry
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lk(job->job_mutex);
+        job->result = std::move(reply);
+    }
+    box->post(id, job->id);
+}
+
+// Picks up the jobs that finished since the last wakeup and writes their responses
+void Reactor::deliverCompleted() {
+    uint64_t count;
+    while (::read(mailbox->efd, &count, sizeof(count)) > 0) {}// reset the counter before taking the list
+
+    std::vector<std::pair<uint64_t, size_t>> ready;
+    std::vector<std::pair<uint64_t, JobPtr>> full;
+    {
+        std::lock_guard<std::mutex> lk(mailbox->m);
+        ready.swap(mailbox->ready);
+        full.swap(mailbox->full);
+        if (mailbox->room) roomRequested = false;// used up
+        mailbox->room = false;
+    }
+    for (auto& [id, job] : full) {
+        auto it = conns.find(id);
+        if (it != conns.end()) {
+            auto pending = it->second.jobs.find(job->id);
+            if (pending != it->second.jobs.end()) {
+                pending->second.parked = true;
+                ++it->second.parked;
+            }
+        }
+        parked.push_back(Parked{id, std::move(job)});
+    }
+    for (const auto& [id, jobId] : ready) {
+        auto it = conns.find(id);
+        if (it == conns.end()) continue;// client disconnected meanwhile
+        Connection& c = it->second;
+        auto pending = c.jobs.find(jobId);
+        if (pending == c.jobs.end()) continue;
+        std::string response;
+        {
+            std::lock_guard<std::mutex> lk(pending->second.job->job_mutex);
+            response = pending->second.job->result;
+        }
+        std::string tag = std::move(pending->second.tag);
+        bool wasParked = pending->second.parked;// e.g. its deadline passed while parked
+        c.jobs.erase(pending);
+        respond(c, tag, response);
+        if (wasParked && --c.parked == 0) resume(id);
+        else flush(id);
+    }
+    admitParked();
+}
+
+/**
+ * @brief Offers the parked jobs to the pipeline again, oldest first, and resumes reading
+ * from the connections whose parked jobs all got in. While the pipeline is still full the
+ * reactor asks to be woken when a job leaves its entry queue.
+ */
+void Reactor::admitParked() {
+    while (!parked.empty()) {
+        Parked& p = parked.front();
+        auto it = conns.find(p.conn);
+        Pending* pending = nullptr;// still waiting for its client
+        if (it != conns.end()) {
+            auto found = it->second.jobs.find(p.job->id);
+            if (found != it->second.jobs.end() && found->second.parked) pending = &found->second;
+        }
+        // A job whose client is gone still runs if identical jobs joined it (cancelJob left it uncancelled)
+        if (p.job->answered.load() || p.job->cancelled.load() || (it != conns.end() && !pending)) {
+            parked.pop_front();
+            continue;
+        }
+        if (getThreadPool().retryJob(p.job) == ThreadPool::Offer::Full) {
+            if (roomRequested) return;
+            roomRequested = true;
+            std::shared_ptr<Mailbox> box = mailbox;
+            getThreadPool().notifyWhenRoom([box] { box->roomFreed(); });
+            continue;// room may have freed up before the callback was registered
+        }
+        uint64_t id = p.conn;
+        parked.pop_front();
+        if (pending) {
+            pending->parked = false;
+            if (--it->second.parked == 0) resume(id);
+        }
+    }
+}
+
+// Carries on with a connection whose parked jobs are all in the pipeline: the frames already
+// read, then whatever arrived on the socket meanwhile (its edge was not acted on)
+void Reactor::resume(uint64_t id) {
+    auto it = conns.find(id);
+    if (it == conns.end()) return;
+    parseInput(id, it->second);
+    readFrom(id);
+    flush(id);
+}
+
+// Queues a response; framed connections get it wrapped in a tagged frame
+void Reactor::respond(Connection& c, const std::string& tag, const std::string& reply) {
+    if (c.mode == Mode::Framed) c.out += encodeFrame(tag, reply);
+    else c.out += reply;
+}
+
+// Writes as much as the socket takes; closes the connection once the client is done and everything is answered
+void Reactor::flush(uint64_t id) {
+    auto it = conns.find(id);
+    if (it == conns.end()) return;
+    Connection& c = it->second;
+
+    while (c.sent < c.out.size()) {
+        ssize_t n = ::send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.sent += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;// wait for EPOLLOUT
+        } else {
+            drop(id);// peer gone
+            return;
+        }
+    }
+    c.out.clear();
+    c.sent = 0;
+    if (c.eof && c.jobs.empty()) drop(id);
+}
+
+void Reactor::drop(uint64_t id) {
+    auto it = conns.find(id);
+    if (it == conns.end()) return;
+    for (auto& [jobId, pending] : it->second.jobs) getThreadPool().cancelJob(pending.job);// nobody will read these
+    ::close(it->second.fd);// also removes it from the epoll set
+    conns.erase(it);
+    Metrics::instance().connectionClosed();
+}
+
+}
@@ -0,0 +1,531 @@
+#include "RequestParser.hpp"
+#include "Arena.hpp"
+#include "BinaryGraph.hpp"
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace graph {
+
+namespace {
+
+// Same set as isspace() in the C locale, which operator>> used to skip
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Whole token must be a decimal int
+inline bool toInt(std::string_view t, int& out) {
+    auto [ptr, ec] = std::from_chars(t.data(), t.data() + t.size(), out);
+    return ec == std::errc() && ptr == t.data() + t.size();
+}
+
+// Runs f and turns an exception from the graph code into the usual ERR reply
+template<typename F>
+bool guarded(F&& f, std::string& error) {
+    try {
+        f();
+        return true;
+    } catch (const std::invalid_argument& e) {
+        error = "ERR INVALID_ARGUMENT: " + std::string(e.what()) + "\n";
+    } catch (const std::out_of_range& e) {
+        error = "ERR OUT_OF_RANGE: " + std::string(e.what()) + "\n";
+    } catch (const std::exception& e) {
+        error = "ERR EXCEPTION: " + std::string(e.what()) + "\n";
+    }
+    return false;
+}
+
+// Whole token must be a decimal number
+inline bool toDouble(std::string_view t, double& out) {
+    auto [ptr, ec] = std::from_chars(t.data(), t.data() + t.size(), out);
+    return ec == std::errc() && ptr == t.data() + t.size();
+}
+
+// How each RANDOM model is written; GRAPH requests use the GNM row for their E line
+struct ModelSyntax {
+    const char* name;
+    RandomModel model;
+    const char* keyword;// introduces the parameter after V
+    const char* expected;// parameter keyword missing
+    const char* invalid;// parameter value malformed
+};
+
+constexpr ModelSyntax MODELS[] = {
+    {"GNM", RandomModel::Gnm, "E", "expected 'E <num_edges>'", "invalid edge count"},
+    {"GNP", RandomModel::Gnp, "P", "expected 'P <probability>'", "invalid edge probability"},
+    {"BA", RandomModel::BarabasiAlbert, "M", "expected 'M <edges_per_vertex>'", "invalid attachment count"},
+    {"GRID", RandomModel::Grid, "W", "expected 'W <width>'", "invalid grid width"},
+    {"GEOMETRIC", RandomModel::Geometric, "R", "expected 'R <radius>'", "invalid radius"},
+};
+
+const ModelSyntax& syntaxOf(RandomModel model) {
+    for (const auto& s : MODELS) {
+        if (s.model == model) return s;
+    }
+    return MODELS[0];
+}
+
+}
+
+void RequestParser::fail(const char* message) {
+    error = std::string("ERR PARSE_FAILED: ") + message + "\n";
+    state = State::Failed;
+}
+
+void RequestParser::feed(std::string_view chunk) {
+    if (state == State::Done || state == State::Failed) return;// the rest is ignored
+    if (!guarded([&] { scan(chunk); }, error)) state = State::Failed;
+}
+
+void RequestParser::scan(std::string_view chunk) {
+    if (sniffing) {// the magic must come first, text requests may start with blanks
+        size_t k = 0;
+        while (k < chunk.size() && carry.size() < bgraph::MAGIC_SIZE && chunk[k] == bgraph::MAGIC[carry.size()]) {
+            carry += chunk[k++];
+        }
+        if (carry.size() == bgraph::MAGIC_SIZE) {
+            sniffing = false;
+            carry.clear();
+            state = State::BinHeader;
+            scanBinary(chunk.substr(k));
+            return;
+        }
+        if (k == chunk.size()) return;// still a prefix of the magic
+        sniffing = false;// text: replay the bytes held back
+        std::string held;
+        held.swap(carry);
+        scanText(held);
+        scanText(chunk.substr(k));
+        return;
+    }
+    if (state == State::BinHeader || state == State::BinEdges) scanBinary(chunk);
+    else scanText(chunk);
+}
+
+// Splits the chunk into whitespace-separated tokens; a token that may continue in the next chunk is kept in carry
+void RequestParser::scanText(std::string_view chunk) {
+    const char* p = chunk.data();
+    const char* end = p + chunk.size();
+    if (!carry.empty()) {
+        const char* q = p;
+        while (q < end && !isSpace(*q)) ++q;
+        carry.append(p, q);
+        if (q == end && carry.size() <= MAX_TOKEN) return;
+        token(carry);
+        carry.clear();
+        p = q;
+    }
+    bool newline = newlineBefore;
+    while (p < end && state != State::Done && state != State::Failed) {
+        while (p < end && isSpace(*p)) {
+            if (*p == '\n' && (state == State::Algs || state == State::Flow || state == State::Mst || state == State::Timeout || state == State::Seed)) {// end of a header line: the request proper may be BGRAPH
+                if (!endHeaderLine()) return;
+                state = State::Tag;
+                sniffing = true;
+                newlineBefore = false;
+                scan(chunk.substr(static_cast<size_t>(p + 1 - chunk.data())));
+                return;
+            }
+            newline |= *p == '\n';
+            ++p;
+        }
+        if (p == end) break;
+
+        // Fast path for the edge lines: numbers are read in place, no token boundaries first
+        if (state == State::EdgeU || state == State::EdgeV || state == State::EdgeW) {
+            int value;
+            auto [q, ec] = std::from_chars(p, end, value);
+            if (ec == std::errc() && q < end && isSpace(*q)) {
+                if (state == State::EdgeW && newline) addPendingEdge(1, State::EdgeU);// previous line had no weight
+                if (state == State::EdgeU) { u = value; state = State::EdgeV; }
+                else if (state == State::EdgeV) { v = value; state = State::EdgeW; }
+                else if (state == State::EdgeW) addPendingEdge(value, State::EdgeU);
+                newline = false;
+                p = q;
+                continue;
+            }
+        }
+
+        const char* q = p;
+        while (q < end && !isSpace(*q)) ++q;
+        if (q == end) {
+            carry.assign(p, q);
+            break;
+        }
+        newlineBefore = newline;
+        token(std::string_view(p, static_cast<size_t>(q - p)));
+        newline = false;
+        p = q;
+    }
+    newlineBefore = newline;
+}
+
+// Checks the ALGS, FLOW, MST, TIMEOUT or SEED line that just ended
+bool RequestParser::endHeaderLine() {
+    if (state == State::Algs && algorithms == 0) {
+        fail("expected algorithm names after 'ALGS'");
+        return false;
+    }
+    bool pairs = !flowValues.empty() && flowValues.size() % 2 == 0;
+    if (state == State::Flow && (params.flowAllPairs ? !flowValues.empty() : !pairs)) {
+        fail("expected vertex pairs or 'ALL' after 'FLOW'");
+        return false;
+    }
+    if (state == State::Mst && !mstParts) {
+        fail("expected 'EDGES' or 'COMPONENTS' after 'MST'");
+        return false;
+    }
+    if (state == State::Timeout && timeoutMs <= 0) {
+        fail("expected milliseconds after 'TIMEOUT'");
+        return false;
+    }
+    if (state == State::Seed && !random.seed) {
+        fail("expected a number after 'SEED'");
+        return false;
+    }
+    return true;
+}
+
+void RequestParser::token(std::string_view t) {
+    bool newline = newlineBefore;
+    newlineBefore = false;
+    if (t.size() > MAX_TOKEN) t = {};// fails like any other malformed token, however it was split
+
+    switch (state) {
+    case State::Tag:
+        if (t == "ALGS") state = State::Algs;
+        else if (t == "FLOW") state = State::Flow;
+        else if (t == "MST") state = State::Mst;
+        else if (t == "TIMEOUT") state = State::Timeout;
+        else if (t == "SEED") state = State::Seed;
+        else if (t == "GRAPH") { kind = Kind::Graph; state = State::VKeyword; }
+        else if (t == "RANDOM") { kind = Kind::Random; state = State::Model; }
+        else if (t == "DEPTH") { kind = Kind::Depth; state = State::Done; }
+        else if (t == "CACHE") { kind = Kind::Cache; state = State::Done; }
+        else if (t == "STATS") { kind = Kind::Stats; state = State::StatsFormat; }
+        else fail("expected 'GRAPH', 'RANDOM', 'DEPTH', 'CACHE' or 'STATS'");
+        return;
+    case State::StatsFormat:
+        if (t == "PROMETHEUS") { prometheus = true; state = State::Done; }
+        else fail("expected 'PROMETHEUS' or nothing after 'STATS'");
+        return;
+    case State::Algs: {
+        int i = AlgorithmFactory::index(t);
+        if (i >= 0) algorithms |= 1u << i;
+        else fail("unknown algorithm in 'ALGS'");
+        return;
+    }
+    case State::Flow: {
+        int x;
+        if (t == "ALL") params.flowAllPairs = true;
+        else if (toInt(t, x) && x >= 0) flowValues.push_back(x);
+        else fail("expected vertex pairs or 'ALL' after 'FLOW'");
+        return;
+    }
+    case State::Mst:
+        if (t == "EDGES") params.mstEdges = true;
+        else if (t == "COMPONENTS") params.mstComponents = true;
+        else fail("expected 'EDGES' or 'COMPONENTS' after 'MST'");
+        mstParts = true;
+        return;
+    case State::Timeout:
+        if (timeoutMs != 0 || !toInt(t, timeoutMs) || timeoutMs <= 0) fail("expected milliseconds after 'TIMEOUT'");
+        return;
+    case State::Seed: {
+        uint64_t seed;
+        auto [ptr, ec] = std::from_chars(t.data(), t.data() + t.size(), seed);
+        if (random.seed || ec != std::errc() || ptr != t.data() + t.size()) fail("expected a number after 'SEED'");
+        else random.seed = seed;
+        return;
+    }
+    case State::Model:// RANDOM: optional model name before V
+        state = State::VKeyword;
+        for (const auto& s : MODELS) {
+            if (t == s.name) {
+                random.model = s.model;
+                return;
+            }
+        }
+        [[fallthrough]];
+    case State::VKeyword:
+        if (t == "V") state = State::VValue;
+        else fail("expected 'V <num_vertices>'");
+        return;
+    case State::VValue:
+        if (toInt(t, V) && V > 0) state = State::EKeyword;
+        else fail("invalid vertex count");
+        return;
+    case State::EKeyword:
+        if (t == syntaxOf(random.model).keyword) state = State::EValue;
+        else fail(syntaxOf(random.model).expected);
+        return;
+    case State::EValue: {
+        bool ok = false;
+        switch (random.model) {
+        case RandomModel::Gnm: ok = toInt(t, E) && E >= 0; random.edges = E; break;
+        case RandomModel::Gnp: ok = toDouble(t, random.probability); break;
+        case RandomModel::BarabasiAlbert: ok = toInt(t, random.attach); break;
+        case RandomModel::Grid: ok = toInt(t, random.width); break;
+        case RandomModel::Geometric: ok = toDouble(t, random.radius); break;
+        }
+        if (!ok) {
+            fail(syntaxOf(random.model).invalid);
+            return;
+        }
+        if (kind == Kind::Random) {// refuse impossible or huge graphs before allocating
+            random.vertices = V;
+            if (const char* bad = validateRandomSpec(random)) {
+                fail(bad);
+                return;
+            }
+        }
+        if (kind == Kind::Graph) edgeList.reserve(static_cast<size_t>(std::min(E, EDGE_RESERVE_MAX)));
+        state = (kind == Kind::Random || E == 0) ? State::Done : State::EdgeU;
+        return;
+    }
+    case State::EdgeW:
+        if (!newline) {// optional weight on the same line
+            int w;
+            if (toInt(t, w)) addPendingEdge(w, State::EdgeU);
+            else fail("invalid edge line format");
+            return;
+        }
+        addPendingEdge(1, State::EdgeU);// the token already starts the next edge line
+        if (state != State::EdgeU) return;
+        [[fallthrough]];
+    case State::EdgeU:
+        if (toInt(t, u)) state = State::EdgeV;
+        else fail("invalid edge line format");
+        return;
+    case State::EdgeV:
+        if (toInt(t, v)) state = State::EdgeW;
+        else fail("invalid edge line format");
+        return;
+    case State::BinHeader:
+    case State::BinEdges:
+    case State::Done:
+    case State::Failed:
+        return;
+    }
+}
+
+// Decodes BGRAPH header and records; a header or record split by the chunk boundary waits in bin
+void RequestParser::scanBinary(std::string_view chunk) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(chunk.data());
+    const unsigned char* end = p + chunk.size();
+
+    if (state == State::BinHeader) {
+        size_t need = bgraph::HEADER_SIZE - bgraph::MAGIC_SIZE - bin.size();
+        size_t k = std::min(need, static_cast<size_t>(end - p));
+        bin.append(reinterpret_cast<const char*>(p), k);
+        p += k;
+        if (k < need) return;
+
+        const unsigned char* h = reinterpret_cast<const unsigned char*>(bin.data());
+        uint8_t version = h[0];
+        uint32_t v32 = bgraph::loadU32(h + 2), e32 = bgraph::loadU32(h + 6);
+        encoding = h[1];
+        bin.clear();
+        if (version != bgraph::VERSION) { fail("unsupported BGRAPH version"); return; }
+        if (encoding != bgraph::RAW && encoding != bgraph::VARINT) { fail("unknown BGRAPH encoding"); return; }
+        if (v32 == 0 || v32 > INT_MAX) { fail("invalid vertex count"); return; }
+        if (e32 > INT_MAX) { fail("invalid edge count"); return; }
+        V = static_cast<int>(v32);
+        E = static_cast<int>(e32);
+        edgeList.reserve(static_cast<size_t>(std::min(E, EDGE_RESERVE_MAX)));
+        state = E == 0 ? State::Done : State::BinEdges;
+    }
+
+    const size_t recordMax = encoding == bgraph::RAW ? bgraph::RAW_RECORD_SIZE : bgraph::MAX_VARINT_RECORD;
+    while (state == State::BinEdges && p < end) {
+        if (!bin.empty()) {// complete the record started in the previous chunk
+            size_t held = bin.size();
+            size_t k = std::min(recordMax - held, static_cast<size_t>(end - p));
+            bin.append(reinterpret_cast<const char*>(p), k);
+            const unsigned char* b = reinterpret_cast<const unsigned char*>(bin.data());
+            const unsigned char* r = binaryRecord(b, b + bin.size());
+            if (!r) {// still incomplete (or failed)
+                p += k;
+                continue;
+            }
+            p += (r - b) - held;
+            bin.clear();
+            continue;
+        }
+        const unsigned char* r;
+        while (state == State::BinEdges && (r = binaryRecord(p, end))) p = r;
+        if (state == State::BinEdges && p < end) {
+            bin.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(end - p));
+            p = end;
+        }
+    }
+}
+
+// Decodes and adds one edge record; returns the byte after it, or nullptr if [p, end) holds no complete record
+const unsigned char* RequestParser::binaryRecord(const unsigned char* p, const unsigned char* end) {
+    uint32_t src, dst;
+    int32_t w;
+    if (encoding == bgraph::RAW) {
+        if (end - p < static_cast<ptrdiff_t>(bgraph::RAW_RECORD_SIZE)) return nullptr;
+        src = bgraph::loadU32(p);
+        dst = bgraph::loadU32(p + 4);
+        w = static_cast<int32_t>(bgraph::loadU32(p + 8));
+        p += bgraph::RAW_RECORD_SIZE;
+    } else {
+        uint32_t dsrc, d, z;
+        bool bad = false;
+        const unsigned char* q = bgraph::readVarint(p, end, dsrc, bad);
+        if (q) q = bgraph::readVarint(q, end, d, bad);
+        if (q) q = bgraph::readVarint(q, end, z, bad);
+        if (bad) {
+            fail("bad BGRAPH varint");
+            return nullptr;
+        }
+        if (!q) return nullptr;
+        uint64_t s64 = uint64_t(prevSrc) + dsrc;
+        uint64_t d64 = dsrc == 0 ? uint64_t(prevDst) + d : d;
+        src = s64 > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(s64);// out of range either way
+        dst = d64 > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(d64);
+        w = bgraph::unzigzag(z);
+        prevSrc = src;
+        prevDst = dst;
+        p = q;
+    }
+    u = src > INT_MAX ? -1 : static_cast<int>(src);
+    v = dst > INT_MAX ? -1 : static_cast<int>(dst);
+    addPendingEdge(w, State::BinEdges);
+    return state == State::Failed ? nullptr : p;
+}
+
+void RequestParser::addPendingEdge(int w, State next) {
+    // Check for negative weights
+    if (w < 0) {
+        fail("negative edge weights are not allowed");
+        return;
+    }
+    // Check for vertex index validity
+    if (u < 0 || u >= V || v < 0 || v >= V) {
+        fail("vertex index out of range");
+        return;
+    }
+    edgeList.push_back({u, v, w});
+    state = (++edges == E) ? State::Done : next;
+}
+
+bool RequestParser::finish(JobPtr& job, std::string& reply) {
+    if (!prepare(job, reply)) return false;
+    if (build(*job, reply)) return true;
+    job.reset();
+    return false;
+}
+
+bool RequestParser::prepare(JobPtr& job, std::string& reply) {
+    if (state != State::Done && state != State::Failed) {
+        if (!guarded([&] {
+                if (!carry.empty()) token(carry);
+                if (state == State::EdgeW) addPendingEdge(1, State::EdgeU);// last edge without a weight
+            }, error)) {
+            state = State::Failed;
+        }
+    }
+    carry.clear();
+
+    switch (state) {
+    case State::Failed: reply = error; return false;
+    case State::Tag:
+    case State::Algs:
+    case State::Flow:
+    case State::Mst:
+    case State::Timeout:
+    case State::Seed: fail("missing request type"); break;
+    case State::Model:
+    case State::VKeyword: fail("expected 'V <num_vertices>'"); break;
+    case State::VValue: fail("invalid vertex count"); break;
+    case State::EKeyword: fail(syntaxOf(random.model).expected); break;
+    case State::EValue: fail(syntaxOf(random.model).invalid); break;
+    case State::EdgeU:
+    case State::EdgeV:
+    case State::EdgeW: fail("invalid edge line format"); break;
+    case State::BinHeader: fail("truncated BGRAPH header"); break;
+    case State::BinEdges: fail("truncated BGRAPH edge records"); break;
+    case State::StatsFormat: state = State::Done; break;// plain STATS
+    case State::Done: break;
+    }
+    if (state == State::Failed) {
+        reply = error;
+        return false;
+    }
+
+    if (kind == Kind::Depth) {//queue depths, so a load balancer can back off early
+        std::ostringstream out;
+        out << "OK DEPTH";
+        for (const auto& [name, depth] : getThreadPool().queueDepths()) out << " " << name << " " << depth;
+        out << " CAPACITY " << getThreadPool().queueCapacity() << "\n";
+        reply = out.str();
+        return false;
+    }
+
+    if (kind == Kind::Cache) {//result cache counters
+        ResultCache::Counters c = getThreadPool().cacheCounters();
+        std::ostringstream out;
+        out << "OK CACHE HITS " << c.hits << " MISSES " << c.misses << " COALESCED " << c.coalesced
+            << " EVICTIONS " << c.evictions << " ENTRIES " << c.entries << " BYTES " << c.bytes
+            << " CAPACITY " << c.capacity << "\n";
+        reply = out.str();
+        return false;
+    }
+
+    if (kind == Kind::Stats) {//latency histograms and counters, as text or for a Prometheus scraper
+        MetricsSnapshot s = Metrics::instance().snapshot();
+        QueueDepths depths = getThreadPool().queueDepths();
+        ResultCache::Counters cache = getThreadPool().cacheCounters();
+        reply = prometheus ? formatPrometheus(s, depths, cache) : formatStats(s, depths, cache);
+        return false;
+    }
+
+    for (size_t i = 0; i + 1 < flowValues.size(); i += 2) {
+        if (flowValues[i] >= V || flowValues[i + 1] >= V) {
+            fail("vertex index out of range");
+            reply = error;
+            return false;
+        }
+        params.flowPairs.emplace_back(flowValues[i], flowValues[i + 1]);
+    }
+
+    job = std::make_shared<Job>();
+    if (algorithms != 0) job->algorithms = algorithms;
+    job->params = std::move(params);
+    job->timeout = std::chrono::milliseconds(timeoutMs);
+    return true;
+}
+
+bool RequestParser::build(Job& job, std::string& reply) {
+    return guarded([&] {
+        // Build the CSR form in one pass; every stage then walks contiguous memory. The graph
+        // and its flow network share one arena, sized for the CSR arrays and freed with the job
+        size_t arcs = 2 * static_cast<size_t>(kind == Kind::Random ? random.edges : E);// GNM knows E up front
+        auto arena = std::make_shared<Arena>(sizeof(Graph) + Graph::frozen_bytes(V, arcs), true);
+        auto G = makeInArena<Graph>(arena, V, arena.get());
+        if (kind == Kind::Random) {
+            generateRandomGraph(*G, random);
+            E = static_cast<int>(G->get_num_of_arcs() / 2);// for the log line
+        } else {
+            G->bulkLoad(edgeList);
+            std::vector<Graph::EdgeRecord>().swap(edgeList);
+        }
+        {
+            std::lock_guard<std::mutex> lk(cout_mutex);
+            std::cerr << "[CSR] graph V=" << V << " E=" << E << " edge array " << static_cast<size_t>(E) * sizeof(Graph::EdgeRecord)
+                      << " bytes -> CSR " << G->memory_bytes() << " bytes" << std::endl;
+        }
+        job.g = std::move(G);
+    }, reply);
+}
+
+}
@@ -0,0 +1,208 @@
+#include "ResultCache.hpp"
+#include "Pipeline.hpp"
+#include <algorithm>
+#include <random>
+
+namespace graph {
+
+namespace {
+
+using CanonicalEdge = ResultCache::CanonicalEdge;
+using CanonicalEdges = ResultCache::CanonicalEdges;
+
+// splitmix64 finalizer: a cheap, well-mixed 64-bit hash of one word
+inline uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Secret folded into the graph hashes, new in every process, so colliding graphs can't be
+// prepared offline against the public mixing constants
+uint64_t hashSeed() {
+    static const uint64_t seed = [] {
+        std::random_device rd;
+        return (uint64_t(rd()) << 32) ^ rd();
+    }();
+    return seed;
+}
+
+// The edges from u to neighbours v >= u, sorted by (v, weight), into out
+void vertexEdges(const Graph& G, int u, CanonicalEdges& out) {
+    out.clear();
+    for (const auto& e : G.neighbors(u)) {
+        if (e.dest >= u) out.push_back({u, e.dest, e.weight});
+    }
+    std::sort(out.begin(), out.end(), [](const CanonicalEdge& a, const CanonicalEdge& b) {
+        return a.v != b.v ? a.v < b.v : a.weight < b.weight;
+    });
+}
+
+CanonicalEdges canonicalEdges(const Graph& G) {
+    CanonicalEdges all, one;
+    all.reserve(G.get_num_of_arcs() / 2 + 1);
+    for (int u = 0; u < G.get_num_of_vertex(); ++u) {
+        vertexEdges(G, u, one);
+        all.insert(all.end(), one.begin(), one.end());
+    }
+    return all;
+}
+
+// Whether G has exactly the stored edges (the vertex counts are equal through the key)
+bool sameEdges(const CanonicalEdges& stored, const Graph& G) {
+    CanonicalEdges one;
+    size_t at = 0;
+    for (int u = 0; u < G.get_num_of_vertex(); ++u) {
+        vertexEdges(G, u, one);
+        if (one.size() > stored.size() - at || !std::equal(one.begin(), one.end(), stored.begin() + at)) return false;
+        at += one.size();
+    }
+    return at == stored.size();
+}
+
+bool sameEdges(const Graph& a, const Graph& b) {
+    if (a.get_num_of_vertex() != b.get_num_of_vertex() || a.get_num_of_arcs() != b.get_num_of_arcs()) return false;
+    CanonicalEdges x, y;
+    for (int u = 0; u < a.get_num_of_vertex(); ++u) {
+        vertexEdges(a, u, x);
+        vertexEdges(b, u, y);
+        if (x != y) return false;
+    }
+    return true;
+}
+
+}
+
+/**
+ * @brief Computes the content address of a frozen graph.
+ * Every undirected edge is hashed on its own and the hashes are summed, so the key does
+ * not depend on the order the edges were sent in; summing (not xor) keeps parallel
+ * edges apart. O(V + E), no sort. Both hashes are seeded per process.
+ * @param G The graph.
+ * @return Its cache key.
+ */
+CacheKey cacheKeyOf(const Graph& G) {
+    CacheKey key;
+    int n = G.get_num_of_vertex();
+    key.vertices = static_cast<uint32_t>(n);
+    const uint64_t seed = hashSeed(), seed2 = mix(seed);
+    for (int u = 0; u < n; ++u) {
+        for (const auto& e : G.neighbors(u)) {
+            if (e.dest < u) continue;// the other copy of u-v (self-loops are stored once)
+            uint64_t ends = (uint64_t(uint32_t(u)) << 32) | uint32_t(e.dest);
+            uint64_t w = uint32_t(e.weight);
+            key.h1 += mix(ends ^ mix(w ^ seed));
+            key.h2 += mix(mix(ends + seed2) ^ (w * 0xd6e8feb86659fd93ULL));
+            ++key.edges;
+        }
+    }
+    return key;
+}
+
+uint64_t optionsKeyOf(unsigned algorithms, const AlgorithmParams& params) {
+    uint64_t h = mix(algorithms | (uint64_t(params.flowAllPairs) << 32) | (uint64_t(params.mstEdges) << 33) |
+                     (uint64_t(params.mstComponents) << 34));
+    for (const auto& [s, t] : params.flowPairs) {// order matters: the response lists the pairs in order
+        h = mix(h ^ ((uint64_t(uint32_t(s)) << 32) | uint32_t(t)));
+    }
+    return h;
+}
+
+ResultCache::Lookup ResultCache::lookup(const CacheKey& key, const std::shared_ptr<Job>& job, std::string& result,
+                                        bool coalesce) {
+    std::shared_ptr<const CanonicalEdges> stored;
+    std::shared_ptr<const Graph> running;// the graph of the flight for key, if any
+    size_t leader = 0;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            stored = it->second->edges;
+            result = it->second->result;
+        }
+        auto flight = coalesce ? inflight.find(key) : inflight.end();
+        if (flight != inflight.end()) {
+            running = flight->second.graph;
+            leader = flight->second.leader;
+        }
+    }
+    // Both comparisons are O(V + E) like the key, so they run outside the lock
+    bool hit = stored && sameEdges(*stored, *job->g);
+    bool same = !hit && running && sameEdges(*running, *job->g);
+
+    std::unique_lock<std::mutex> lk(m);
+    if (hit) {
+        auto it = index.find(key);
+        if (it != index.end()) lru.splice(lru.begin(), lru, it->second);// most recently used, unless evicted meanwhile
+        ++hits;
+        return Lookup::Hit;
+    }
+    while (coalesce) {
+        auto flight = inflight.find(key);
+        if (flight == inflight.end()) {
+            inflight.emplace(key, Flight{job->id, job->g, {}});
+            break;
+        }
+        if (running && flight->second.leader == leader) {// the flight that was compared
+            if (!same) break;// a different graph: it runs on its own
+            flight->second.followers.push_back(job);
+            ++coalesced;
+            return Lookup::Joined;
+        }
+        running = flight->second.graph;// another leader took over meanwhile: compare with its graph
+        leader = flight->second.leader;
+        lk.unlock();
+        same = sameEdges(*running, *job->g);
+        lk.lock();
+    }
+    ++misses;
+    return Lookup::Miss;
+}
+
+std::vector<std::shared_ptr<Job>> ResultCache::finish(const CacheKey& key, size_t leader, const Graph& graph,
+                                                      const std::string& result, bool cacheable) {
+    std::shared_ptr<const CanonicalEdges> edges;// built outside the lock
+    if (cacheable && entryBytes(result.size(), key.edges) <= capacity) {
+        edges = std::make_shared<const CanonicalEdges>(canonicalEdges(graph));
+    }
+
+    std::lock_guard<std::mutex> lk(m);
+    std::vector<std::shared_ptr<Job>> followers;
+    auto flight = inflight.find(key);
+    if (flight != inflight.end() && flight->second.leader == leader) {// not if abandoned (and maybe restarted)
+        followers.swap(flight->second.followers);
+        inflight.erase(flight);
+    }
+
+    if (!edges || index.count(key)) return followers;
+
+    size_t size = entryBytes(result.size(), edges->size());
+    lru.push_front(Entry{key, result, std::move(edges)});
+    index.emplace(key, lru.begin());
+    bytes += size;
+    while (bytes > capacity) {// evict least recently used
+        const Entry& old = lru.back();
+        bytes -= entryBytes(old.result.size(), old.edges->size());
+        index.erase(old.key);
+        lru.pop_back();
+        ++evictions;
+    }
+    return followers;
+}
+
+bool ResultCache::abandon(const CacheKey& key, size_t leader) {
+    std::lock_guard<std::mutex> lk(m);
+    auto flight = inflight.find(key);
+    if (flight == inflight.end() || flight->second.leader != leader) return true;// already over
+    if (!flight->second.followers.empty()) return false;
+    inflight.erase(flight);
+    return true;
+}
+
+ResultCache::Counters ResultCache::counters() const {
+    std::lock_guard<std::mutex> lk(m);
+    return Counters{hits, misses, coalesced, evictions, index.size(), bytes, capacity};
+}
+
+}
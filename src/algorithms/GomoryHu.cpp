@@ -0,0 +1,126 @@
+#include "algorithms/GomoryHu.hpp"
+#include "Arena.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <stdexcept>
+#include <thread>
+
+namespace graph {
+
+long long GomoryHuTree::min_cut(int u, int v) const {
+    if (u == v) return 0;
+    long long best = LLONG_MAX;
+    while (u != v) {// climb from the deeper end until the paths meet
+        if (depth[u] < depth[v]) std::swap(u, v);
+        best = std::min(best, weight[u]);
+        u = parent[u];
+    }
+    return best;
+}
+
+/**
+ * @brief Builds the flow-equivalent tree with Gusfield's algorithm.
+ * Step s cuts s from its current parent and re-hangs the later vertices on s's side of
+ * the cut below s. Only the parent of s decides what step s computes, so a window of
+ * steps is cut in parallel against the parents they have now and then committed in
+ * order; a step whose parent was changed by an earlier commit of the same window is
+ * cut again in the next window. The first step of a window always commits.
+ * @param G The graph (undirected, edge weights as capacities).
+ * @param threads Number of workers; 0 uses std::thread::hardware_concurrency().
+ * @param cancel Polled before every cut; may be null.
+ * @param stopped Set to whether the construction gave up early; may be null.
+ * @return The tree.
+ */
+GomoryHuTree gomory_hu_tree(const Graph& G, unsigned threads, const CancelToken* cancel, bool* stopped) {
+    int n = G.get_num_of_vertex();
+    GomoryHuTree tree;
+    tree.parent.assign(n, 0);
+    tree.weight.assign(n, 0);
+    tree.depth.assign(n, 0);
+    if (stopped) *stopped = false;
+    if (n <= 1) return tree;
+
+    threads = resolveThreads(threads);
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(n - 1));
+
+    struct Cut {
+        int t;
+        long long flow;
+        std::vector<char> side;
+    };
+    std::vector<Cut> window(threads);
+    std::atomic<bool> stop{false};
+
+    for (int s = 1; s < n;) {
+        int k = std::min<int>(static_cast<int>(threads), n - s);
+        for (int i = 0; i < k; ++i) window[i].t = tree.parent[s + i];
+        parallelFor(static_cast<size_t>(k), threads, [&](size_t i) {
+            if (stop.load(std::memory_order_relaxed)) return;
+            if (cancel && cancel->stopRequested()) {// one max flow is the unit of work
+                stop.store(true, std::memory_order_relaxed);
+                return;
+            }
+            ScratchScope scope;// the flow's residual network, freed when the cut is done
+            Cut& c = window[i];
+            c.flow = G.min_cut(s + static_cast<int>(i), c.t, c.side);
+        });
+        if (stop.load()) break;// some cuts of the window were skipped
+
+        int i = 0;
+        for (; i < k && tree.parent[s + i] == window[i].t; ++i) {
+            int v = s + i;
+            const Cut& c = window[i];
+            tree.weight[v] = c.flow;
+            for (int j = v + 1; j < n; ++j) {
+                if (c.side[j] && tree.parent[j] == c.t) tree.parent[j] = v;
+            }
+        }
+        s += i;
+    }
+    if (stopped) *stopped = stop.load();
+
+    for (int v = 1; v < n; ++v) tree.depth[v] = tree.depth[tree.parent[v]] + 1;// parent[v] < v
+    return tree;
+}
+
+/**
+ * @brief Answers a batch of max flow queries on one graph.
+ * @param G The graph.
+ * @param pairs (source, sink) pairs.
+ * @param threads Number of workers; 0 uses std::thread::hardware_concurrency().
+ * @param cancel Polled before every max flow; may be null.
+ * @param stopped Set to whether some flows were skipped because cancel fired; may be null.
+ * @return The max flow of every pair, in order.
+ * @throws std::out_of_range if a vertex index is invalid.
+ */
+std::vector<long long> max_flows(const Graph& G, const std::vector<std::pair<int, int>>& pairs, unsigned threads,
+                                 const CancelToken* cancel, bool* stopped) {
+    int n = G.get_num_of_vertex();
+    for (const auto& [s, t] : pairs) {
+        if (s < 0 || s >= n || t < 0 || t >= n) throw std::out_of_range("Vertex index out of range");
+    }
+    threads = resolveThreads(threads);
+
+    std::vector<long long> flows(pairs.size());
+    if (pairs.size() >= static_cast<size_t>(n - 1)) {
+        GomoryHuTree tree = gomory_hu_tree(G, threads, cancel, stopped);
+        for (size_t i = 0; i < pairs.size(); ++i) flows[i] = tree.min_cut(pairs[i].first, pairs[i].second);
+        return flows;
+    }
+    std::atomic<bool> stop{false};
+    parallelFor(pairs.size(), threads, [&](size_t i) {
+        if (stop.load(std::memory_order_relaxed)) return;
+        if (cancel && cancel->stopRequested()) {
+            stop.store(true, std::memory_order_relaxed);
+            return;
+        }
+        ScratchScope scope;
+        flows[i] = G.max_flow(pairs[i].first, pairs[i].second);
+    });
+    if (stopped) *stopped = stop.load();
+    return flows;
+}
+
+}
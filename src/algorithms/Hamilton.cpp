@@ -1,67 +1,310 @@
 #include "algorithms/Hamilton.hpp"
-#include <functional>
+#include "Arena.hpp"
 
-#include <unordered_set>
 #include <algorithm>
 
 using namespace graph;
 
 namespace {
 
-// Checks if there is an edge between vertices u and v
-bool hasEdge(const Graph& G, int u, int v){
+// Temporaries come from the worker's scratch arena (see Arena.hpp)
+template<typename T>
+using Scratch = std::pmr::vector<T>;
+using AdjLists = Scratch<Scratch<int>>;
 
-    auto edges = G.get_edges(); // Get all edges in the graph
-    //if (u>v) std::swap(u,v);// Ensure u < v
-    for (auto &e : edges){
-        int a,b;//src, dest
-        a = std::get<0>(e);
-        b = std::get<1>(e);
-        
-        if ((a==u && b==v) || (a==v &&b==u)) return true;
+// Simple adjacency lists without self-loops or parallel edges
+AdjLists simpleAdjacency(const Graph& G) {
+    int n = G.get_num_of_vertex();
+    AdjLists adj(n, scratch());
+    for (int u = 0; u < n; ++u) {
+        for (const auto& e : G.neighbors(u)) {
+            if (e.dest != u) adj[u].push_back(e.dest);
+        }
+        std::sort(adj[u].begin(), adj[u].end());
+        adj[u].erase(std::unique(adj[u].begin(), adj[u].end()), adj[u].end());
     }
-    return false;
+    return adj;
 }
+
+/**
+ * Checks that the subgraph induced by the vertices with inSub[v] set is connected and
+ * has no articulation point (iterative Tarjan). A Hamiltonian cycle needs both.
+ * extraU/extraV, if not -1, add one virtual edge between them.
+ */
+bool isBiconnected(const AdjLists& adj, const Scratch<char>& inSub,
+                   int root, int count, int extraU = -1, int extraV = -1) {
+    if (count <= 2) return true;
+    int n = static_cast<int>(adj.size());
+    std::pmr::memory_resource* mr = scratch();
+    Scratch<int> disc(n, -1, mr), low(n, 0, mr), parent(n, -1, mr);
+    Scratch<size_t> next(n, 0, mr);
+    Scratch<int> stack(1, root, mr);
+    int time = 0, visited = 1, rootChildren = 0;
+    disc[root] = low[root] = time++;
+
+    // neighbour i of u, where index adj[u].size() stands for the virtual edge
+    auto neighbour = [&](int u, size_t i) -> int {
+        if (i < adj[u].size()) return adj[u][i];
+        if (u == extraU) return extraV;
+        if (u == extraV) return extraU;
+        return -1;
+    };
+
+    while (!stack.empty()) {
+        int u = stack.back();
+        if (next[u] <= adj[u].size()) {
+            int w = neighbour(u, next[u]++);
+            if (w < 0 || !inSub[w]) continue;
+            if (disc[w] < 0) {
+                parent[w] = u;
+                disc[w] = low[w] = time++;
+                ++visited;
+                if (u == root) ++rootChildren;
+                stack.push_back(w);
+            } else if (w != parent[u]) {
+                low[u] = std::min(low[u], disc[w]);
+            }
+            continue;
+        }
+        stack.pop_back();
+        int p = parent[u];
+        if (p >= 0) {
+            low[p] = std::min(low[p], low[u]);
+            if (p != root && low[u] >= disc[p]) return false;// p is an articulation point
+        }
+    }
+    return visited == count && rootChildren <= 1;
 }
 
 /**
- * Finds a Hamiltonian cycle in the given graph.
- * @param G The input graph
- * @return A vector containing the vertices in the Hamiltonian cycle, or an empty vector if no such cycle exists
+ * Held-Karp style reachability over subsets: dp[mask] holds every end vertex v such
+ * that some path starts at 0, visits exactly the vertices of mask and ends at v.
+ * Vertex v (1..n-1) is bit v-1.
  */
-std::vector<int> find_hamiltonian_cycle(const Graph& G){
-    int n = G.get_num_of_vertex();
-    if (n<=1) return {};
-
-    std::vector<int> path(n, -1), best;
-    std::vector<char> used(n, false);// Track used vertices
-    std::vector<int> res;
-
-    // Depth-first search (DFS) to find Hamiltonian cycle
-    std::function<bool(int)> dfs = [&](int index)->bool{
-        // Check if all vertices are included
-        if (index==n){
-            if (hasEdge(G, path[n-1], path[0])) {
-                res = path;
-                res.push_back(path[0]); // Close the cycle
-                return true;
+std::vector<int> heldKarp(const AdjLists& adj, HamiltonStats& stats, CancelPoll& stop) {
+    int n = static_cast<int>(adj.size());
+    int m = n - 1;
+    std::vector<uint32_t> nb(m, 0);
+    uint32_t fromStart = 0;
+    for (int v : adj[0]) fromStart |= 1u << (v - 1);
+    for (int u = 1; u < n; ++u) {
+        for (int v : adj[u]) if (v != 0) nb[u - 1] |= 1u << (v - 1);
+    }
+
+    uint32_t full = (m == 32) ? ~0u : ((1u << m) - 1);
+    std::vector<uint32_t> dp(size_t(full) + 1, 0);
+    for (int i = 0; i < m; ++i) dp[1u << i] = fromStart & (1u << i);
+
+    if (fromStart) stats.longestPath = 2;
+    for (uint32_t mask = 1; mask <= full && mask != 0; ++mask) {
+        if ((mask & (mask - 1)) == 0) continue;// singletons are seeded above
+        if (stop()) {
+            stats.stopped = true;
+            return {};
+        }
+        uint32_t ends = 0;
+        for (uint32_t rest = mask; rest; rest &= rest - 1) {
+            int i = __builtin_ctz(rest);
+            ++stats.nodes;
+            if (dp[mask ^ (1u << i)] & nb[i]) ends |= 1u << i;
+        }
+        dp[mask] = ends;
+        if (ends) stats.longestPath = std::max<size_t>(stats.longestPath, __builtin_popcount(mask) + 1);
+    }
+
+    uint32_t closing = dp[full] & fromStart;
+    if (!closing) return {};
+
+    // Walk back from a closing end vertex
+    std::vector<int> cycle{0};
+    uint32_t mask = full;
+    int last = __builtin_ctz(closing);
+    while (mask) {
+        cycle.push_back(last + 1);
+        mask ^= 1u << last;
+        if (!mask) break;
+        last = __builtin_ctz(dp[mask] & nb[last]);
+    }
+    cycle.push_back(0);
+    std::reverse(cycle.begin(), cycle.end());
+    return cycle;
+}
+
+/**
+ * Depth-first branch and bound for graphs too big for the DP. The path grows from
+ * `start`; a branch is cut when an unvisited vertex can no longer get two path
+ * links, or when the unvisited vertices plus both path ends (joined by a virtual
+ * edge) are not biconnected. Successors are tried fewest-free-neighbours first.
+ * The successor lists of all open frames share one stack, and the connectivity check
+ * runs in its own scratch scope, so a node costs no heap allocation.
+ */
+class BranchAndBound {
+    const AdjLists& adj;
+    int n, start;
+    Scratch<char> visited;
+    Scratch<int> freeDeg;// unvisited neighbours of each vertex
+    Scratch<int> path;
+    Scratch<int> candStack;// successors of every open frame, innermost last
+    HamiltonStats& stats;
+    CancelPoll& stop;
+
+    struct Frame {
+        int v;
+        size_t begin, end;// its successors: candStack[begin .. end)
+        size_t next;
+    };
+
+    bool linked(int u, int v) const {
+        return std::binary_search(adj[u].begin(), adj[u].end(), v);
+    }
+
+    void visit(int v) {
+        visited[v] = 1;
+        path.push_back(v);
+        stats.longestPath = std::max(stats.longestPath, path.size());
+        for (int w : adj[v]) --freeDeg[w];
+    }
+
+    void unvisit(int v) {
+        visited[v] = 0;
+        path.pop_back();
+        for (int w : adj[v]) ++freeDeg[w];
+    }
+
+    // Links still available to an unvisited vertex u while the path ends at cur
+    int available(int u, int cur) const {
+        return freeDeg[u] + linked(u, cur) + linked(u, start);
+    }
+
+    bool feasible(int cur, int prev) const {
+        int remaining = n - static_cast<int>(path.size());
+        if (remaining == 0) return true;
+        if (freeDeg[start] == 0) return false;// start can't be re-entered
+        for (int side : {cur, prev}) {
+            for (int u : adj[side]) {
+                if (!visited[u] && available(u, cur) < 2) return false;
             }
-            return false;
         }
-        // Try all possible next vertices
-        for (int v=0; v<n; ++v){
-            if (!used[v] &&(index==0 || hasEdge(G, path[index-1], v))){
-                path[index]=v;
-                used[v]=true;
+        if (remaining < 2) return true;
 
-                if (dfs(index+1)) return true;
-                path[index]=-1;
+        ScratchScope check;// inSub and the Tarjan arrays, gone when the check returns
+        Scratch<char> inSub(n, 0, scratch());
+        for (int v = 0; v < n; ++v) inSub[v] = !visited[v];
+        inSub[cur] = inSub[start] = 1;
+        return isBiconnected(adj, inSub, cur, remaining + 2, cur, start);
+    }
+
+    // Opens a frame for cur with its unvisited neighbours on top of candStack
+    Frame open(int cur) {
+        size_t begin = candStack.size();
+        for (int u : adj[cur]) if (!visited[u]) candStack.push_back(u);
+        std::sort(candStack.begin() + static_cast<std::ptrdiff_t>(begin), candStack.end(),
+                  [&](int a, int b) { return freeDeg[a] < freeDeg[b]; });
+        return {cur, begin, candStack.size(), begin};
+    }
+
+public:
+    BranchAndBound(const AdjLists& a, int s, HamiltonStats& st, CancelPoll& stop)
+        : adj(a), n(static_cast<int>(a.size())), start(s), visited(n, 0, scratch()), freeDeg(n, scratch()),
+          path(scratch()), candStack(scratch()), stats(st), stop(stop) {
+        for (int v = 0; v < n; ++v) freeDeg[v] = static_cast<int>(adj[v].size());
+        path.reserve(n);
+    }
 
-                used[v]=false;
+    std::vector<int> run() {
+        visit(start);
+        Scratch<Frame> frames(scratch());
+        frames.push_back(open(start));
+
+        while (!frames.empty()) {
+            if (stop()) {
+                stats.stopped = true;
+                return {};
+            }
+            Frame& f = frames.back();
+            if (f.next == f.end) {
+                unvisit(f.v);
+                candStack.resize(f.begin);
+                frames.pop_back();
+                continue;
+            }
+            int prev = f.v;
+            int u = candStack[f.next++];
+            if (visited[u]) continue;
+
+            visit(u);
+            ++stats.nodes;
+            if (static_cast<int>(path.size()) == n) {
+                if (linked(u, start)) {
+                    std::vector<int> cycle(path.begin(), path.end());
+                    cycle.push_back(start);
+                    return cycle;
+                }
+                unvisit(u);
+                continue;
             }
+            if (!feasible(u, prev)) {
+                unvisit(u);
+                continue;
+            }
+            frames.push_back(open(u));
         }
-        return false;
-    };
-    dfs(0);// Start DFS from the second vertex
-    return res;// Return the best found Hamiltonian cycle
+        return {};
+    }
+};
+
+}
+
+/**
+ * Finds a Hamiltonian cycle in the given graph.
+ * Small graphs use the bitmask DP, bigger ones the branch and bound search; both are
+ * preceded by a degree and biconnectivity check that rejects most hopeless inputs.
+ * @param G The input graph
+ * @param stats Optional output: which strategy ran and how many nodes it expanded
+ * @param cancel Optional: polled during the search, which returns no cycle (stats->stopped) once it fires
+ * @return A vector containing the vertices in the Hamiltonian cycle (starting and ending at 0),
+ * or an empty vector if no such cycle exists
+ */
+std::vector<int> find_hamiltonian_cycle(const Graph& G, HamiltonStats* stats, const CancelToken* cancel) {
+    HamiltonStats local;
+    HamiltonStats& st = stats ? *stats : local;
+    st = HamiltonStats{};
+
+    int n = G.get_num_of_vertex();
+    if (n <= 1) {
+        st.strategy = "trivial";
+        return {};
+    }
+
+    auto adj = simpleAdjacency(G);
+
+    if (n >= 3) {
+        st.strategy = "precheck";
+        int minDeg = n;
+        for (const auto& a : adj) minDeg = std::min(minDeg, static_cast<int>(a.size()));
+        if (minDeg < 2) return {};
+        if (!isBiconnected(adj, Scratch<char>(n, 1, scratch()), 0, n)) return {};
+    }
+
+    std::vector<int> cycle;
+    CancelPoll stop(cancel);
+    if (n <= HELD_KARP_MAX_VERTICES) {
+        st.strategy = "held-karp";
+        cycle = heldKarp(adj, st, stop);
+    } else {
+        st.strategy = "branch-and-bound";
+        int start = 0;// most constrained vertex keeps the first branching narrow
+        for (int v = 1; v < n; ++v) {
+            if (adj[v].size() < adj[start].size()) start = v;
+        }
+        cycle = BranchAndBound(adj, start, st, stop).run();
+    }
+
+    // Rotate so the cycle starts (and ends) at vertex 0, as before
+    if (!cycle.empty() && cycle.front() != 0) {
+        cycle.pop_back();
+        std::rotate(cycle.begin(), std::find(cycle.begin(), cycle.end(), 0), cycle.end());
+        cycle.push_back(0);
+    }
+    return cycle;
 }
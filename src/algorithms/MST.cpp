@@ -1,20 +1,33 @@
 #include "algorithms/MST.hpp"
 #include "Graph.hpp"
+#include "Arena.hpp"
+#include "Parallel.hpp"
 #include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
 
 /**
- * implement Kruskal's algorithm for finding the minimum spanning tree (MST) of a graph
+ * implement Kruskal's algorithm for finding the minimum spanning tree (MST) of a graph,
+ * and the faster strategies picked by compute_mst_weight()
  */
 namespace {
 
+using graph::parallelBlocks;
+
+template<typename T>
+using Scratch = std::pmr::vector<T>;// temporaries come from the worker's scratch arena (see Arena.hpp)
+
 struct DSU {// Disjoint Set Union (DSU) data structure
-    std::vector<int> p, r;//p[i] = parent of i, r[i] = rank of i
+    std::pmr::vector<int> p, r;//p[i] = parent of i, r[i] = rank of i
 
-    explicit DSU(int n): p(n), r(n,0) { for (int i=0;i<n;++i) p[i]=i; }//constructor
+    DSU(int n, std::pmr::memory_resource* mr): p(n, mr), r(n, 0, mr) { for (int i=0;i<n;++i) p[i]=i; }//constructor
 
     int find(int x){ return p[x]==x?x:p[x]=find(p[x]); }//find return the candidate of the set
 
-    bool unite(int a,int b){//union the sets that contain a and b 
+    int root(int x) const { while (p[x]!=x) x=p[x]; return x; }//find without path compression: safe from several threads
+
+    bool unite(int a,int b){//union the sets that contain a and b
         a=find(a); b=find(b);
         if(a==b) return false;
         if(r[a]<r[b]) std::swap(a,b);
@@ -23,30 +36,428 @@ struct DSU {// Disjoint Set Union (DSU) data structure
         return true;
     }
 };
+
+struct WEdge {
+    int u, v, w;
+};
+
+// Numbers the trees of a finished union-find in order of their lowest vertex
+void labelComponents(DSU& dsu, MstForest& forest, std::pmr::memory_resource* mr) {
+    const int n = static_cast<int>(dsu.p.size());
+    Scratch<int> label(static_cast<size_t>(n), -1, mr);// tree number of each root
+    forest.component.resize(static_cast<size_t>(n));
+    forest.components = 0;
+    for (int v = 0; v < n; ++v) {
+        int& l = label[dsu.find(v)];
+        if (l < 0) l = forest.components++;
+        forest.component[v] = l;
+    }
 }
 
-/** 
+constexpr size_t FILTER_KRUSKAL_BASE = 256;// ranges this small are sorted outright
+
+// Each undirected edge once (u < v, self-loops dropped), read straight from the CSR lists
+Scratch<WEdge> edgeArray(const graph::Graph& G, std::pmr::memory_resource* mr) {
+    Scratch<WEdge> edges(mr);
+    edges.reserve(G.get_num_of_arcs() / 2 + 1);
+    for (int u = 0; u < G.get_num_of_vertex(); ++u) {
+        for (const auto& e : G.neighbors(u)) {
+            if (u < e.dest) edges.push_back({u, e.dest, e.weight});
+        }
+    }
+    return edges;
+}
+
+/**
+ * Filter-Kruskal (Osipov, Sanders, Singler): partition the edges around a pivot weight
+ * like quicksort, run on the light part first, then drop every heavier edge whose ends
+ * are already connected before recursing on it. Most edges of a dense graph are dropped
+ * by a union-find test instead of being sorted. Ties with the pivot form their own
+ * class, so runs of equal weights (1..10 here) cannot make the recursion stall.
+ */
+class FilterKruskal {
+    DSU dsu;
+    int need;// edges still missing from a spanning tree
+    MstForest* forest;// receives the edges taken, if given
+
+    void kruskal(WEdge* first, WEdge* last) {
+        std::sort(first, last, [](const WEdge& a, const WEdge& b) { return a.w < b.w; });
+        for (WEdge* e = first; e != last && need > 0; ++e) take(*e);
+    }
+
+    void take(const WEdge& e) {
+        if (dsu.unite(e.u, e.v)) {
+            total += e.w;
+            --need;
+            if (forest) forest->edges.push_back({e.u, e.v, e.w});
+        }
+    }
+
+    WEdge* filter(WEdge* first, WEdge* last) {
+        return std::remove_if(first, last, [&](const WEdge& e) { return dsu.find(e.u) == dsu.find(e.v); });
+    }
+
+    // Like introsort, past depthLeft levels the range is sorted outright: clients choose the
+    // edge order, and one made against the median-of-three could otherwise nest as deep as it is long
+    void run(WEdge* first, WEdge* last, int depthLeft) {
+        if (need <= 0 || first == last) return;
+        size_t size = static_cast<size_t>(last - first);
+        if (size <= FILTER_KRUSKAL_BASE || depthLeft == 0) {
+            kruskal(first, last);
+            return;
+        }
+        int a = first[size / 4].w, b = first[size / 2].w, c = first[3 * size / 4].w;
+        int pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));// median of three
+        WEdge* lighter = std::partition(first, last, [&](const WEdge& e) { return e.w < pivot; });
+        WEdge* heavier = std::partition(lighter, last, [&](const WEdge& e) { return e.w == pivot; });
+        run(first, lighter, depthLeft - 1);
+        for (WEdge* e = lighter; e != heavier && need > 0; ++e) take(*e);// one weight: any order is sorted
+        run(heavier, filter(heavier, last), depthLeft - 1);
+    }
+
+public:
+    long long total = 0;
+
+    FilterKruskal(int n, MstForest* forest, std::pmr::memory_resource* mr) : dsu(n, mr), need(n - 1), forest(forest) {}
+
+    void run(WEdge* first, WEdge* last) {
+        int levels = 0;
+        for (size_t size = static_cast<size_t>(last - first); size > 1; size >>= 1) ++levels;
+        run(first, last, 2 * levels);
+    }
+
+    void label(MstForest& out, std::pmr::memory_resource* mr) { labelComponents(dsu, out, mr); }
+};
+
+// Binary min-heap of vertices keyed by key[v], with decrease-key through pos[v]
+class VertexHeap {
+    Scratch<int> heap, pos;// pos[v] = index of v in heap, -1 if absent
+    const Scratch<long long>& key;
+
+    void place(size_t i, int v) {
+        heap[i] = v;
+        pos[v] = static_cast<int>(i);
+    }
+
+    void up(size_t i) {
+        int v = heap[i];
+        while (i > 0 && key[heap[(i - 1) / 2]] > key[v]) {
+            place(i, heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        place(i, v);
+    }
+
+    void down(size_t i) {
+        int v = heap[i];
+        for (size_t c; (c = 2 * i + 1) < heap.size(); i = c) {
+            if (c + 1 < heap.size() && key[heap[c + 1]] < key[heap[c]]) ++c;
+            if (key[heap[c]] >= key[v]) break;
+            place(i, heap[c]);
+        }
+        place(i, v);
+    }
+
+public:
+    VertexHeap(int n, const Scratch<long long>& key, std::pmr::memory_resource* mr)
+        : heap(mr), pos(n, -1, mr), key(key) {}
+
+    bool empty() const { return heap.empty(); }
+
+    // Inserts v, or moves it up after key[v] was lowered
+    void push(int v) {
+        if (pos[v] < 0) {
+            heap.push_back(v);
+            pos[v] = static_cast<int>(heap.size() - 1);
+        }
+        up(static_cast<size_t>(pos[v]));
+    }
+
+    int pop() {
+        int top = heap.front();
+        pos[top] = -1;
+        int last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            place(0, last);
+            down(0);
+        }
+        return top;
+    }
+};
+
+/**
+ * Prim over the CSR lists, restarted in every component. A key only moves when an edge
+ * is strictly lighter than the vertex's best so far, so on dense graphs most edges cost a
+ * comparison and no heap operation; no edge array is built at all. Every restart opens
+ * the next tree, so the trees come out numbered by their lowest vertex.
+ */
+long long prim(const graph::Graph& G, MstForest* forest, std::pmr::memory_resource* mr) {
+    int n = G.get_num_of_vertex();
+    Scratch<long long> key(n, LLONG_MAX, mr);
+    Scratch<char> done(n, 0, mr);
+    Scratch<int> from(forest ? n : 0, mr);// from[v] = tree end of the edge behind key[v]
+    VertexHeap heap(n, key, mr);
+    long long total = 0;
+    if (forest) {
+        forest->component.resize(static_cast<size_t>(n));
+        forest->components = 0;
+    }
+    for (int s = 0; s < n; ++s) {
+        if (done[s]) continue;
+        key[s] = 0;
+        heap.push(s);
+        while (!heap.empty()) {
+            int u = heap.pop();
+            done[u] = 1;
+            total += key[u];
+            if (forest) {
+                forest->component[u] = forest->components;
+                if (u != s) forest->edges.push_back({std::min(from[u], u), std::max(from[u], u), static_cast<int>(key[u])});
+            }
+            for (const auto& e : G.neighbors(u)) {
+                if (!done[e.dest] && e.weight < key[e.dest]) {
+                    key[e.dest] = e.weight;
+                    if (forest) from[e.dest] = u;
+                    heap.push(e.dest);
+                }
+            }
+        }
+        if (forest) ++forest->components;
+    }
+    return total;
+}
+
+/**
+ * Boruvka in rounds. Every component picks its cheapest outgoing edge under a strict
+ * order (weight, then identity), so the picks form a forest; they are merged, and the
+ * edges left between different components are kept with their ends renamed to the
+ * component roots. The first round reads the CSR lists directly (each vertex is its
+ * own component, so no atomics are needed) and only the edges that survive it are
+ * copied out; later rounds take an atomic minimum over (weight, index). The passes run
+ * on `threads` workers; only the merge, one pick per component, is sequential. For a
+ * forest the original ends travel alongside the renamed edges.
+ */
+long long boruvka(const graph::Graph& G, unsigned threads, MstForest* forest, std::pmr::memory_resource* mr) {
+    const int n = G.get_num_of_vertex();
+    const size_t vertices = static_cast<size_t>(n);
+    const size_t blocks = size_t(threads) * 4;
+    DSU dsu(n, mr);
+    Scratch<int> comp(vertices, mr);
+    Scratch<size_t> counts(blocks + 1, 0, mr);
+    long long total = 0;
+
+    auto relabel = [&] {
+        parallelBlocks(vertices, blocks, threads, [&](size_t, size_t lo, size_t hi) {
+            for (size_t v = lo; v < hi; ++v) comp[v] = dsu.root(static_cast<int>(v));
+        });
+    };
+
+    // Round one: the cheapest edge of every vertex's list, ties broken by the (smaller, larger) end pair
+    {
+        Scratch<WEdge> pick(vertices, WEdge{-1, -1, 0}, mr);
+        auto lighter = [](const WEdge& a, const WEdge& b) {
+            return a.w != b.w ? a.w < b.w : std::make_pair(a.u, a.v) < std::make_pair(b.u, b.v);
+        };
+        parallelBlocks(vertices, blocks, threads, [&](size_t, size_t lo, size_t hi) {
+            for (size_t v = lo; v < hi; ++v) {
+                int u = static_cast<int>(v);
+                for (const auto& e : G.neighbors(u)) {
+                    if (e.dest == u) continue;
+                    WEdge c{std::min(u, e.dest), std::max(u, e.dest), e.weight};
+                    if (pick[v].u < 0 || lighter(c, pick[v])) pick[v] = c;
+                }
+            }
+        });
+        for (const WEdge& e : pick) {
+            if (e.u >= 0 && dsu.unite(e.u, e.v)) {
+                total += e.w;
+                if (forest) forest->edges.push_back({e.u, e.v, e.w});
+            }
+        }
+    }
+    relabel();
+
+    // The edges between different components, ends renamed: count per block of vertices, then scatter
+    const size_t vblocks = std::max<size_t>(1, std::min(blocks, vertices));
+    parallelBlocks(vertices, vblocks, threads, [&](size_t b, size_t lo, size_t hi) {
+        size_t c = 0;
+        for (size_t v = lo; v < hi; ++v) {
+            for (const auto& e : G.neighbors(static_cast<int>(v))) c += static_cast<int>(v) < e.dest && comp[v] != comp[e.dest];
+        }
+        counts[b + 1] = c;
+    });
+    for (size_t b = 0; b < vblocks; ++b) counts[b + 1] += counts[b];
+    Scratch<WEdge> edges(counts[vblocks], mr), kept(mr);
+    Scratch<std::pair<int, int>> ends(forest ? counts[vblocks] : 0, mr), keptEnds(mr);// original ends of edges[i]
+    parallelBlocks(vertices, vblocks, threads, [&](size_t b, size_t lo, size_t hi) {
+        size_t at = counts[b];
+        for (size_t v = lo; v < hi; ++v) {
+            for (const auto& e : G.neighbors(static_cast<int>(v))) {
+                if (static_cast<int>(v) < e.dest && comp[v] != comp[e.dest]) {
+                    if (forest) ends[at] = {static_cast<int>(v), e.dest};
+                    edges[at++] = {comp[v], comp[e.dest], e.weight};
+                }
+            }
+        }
+    });
+
+    const uint64_t none = UINT64_MAX;
+    Scratch<std::atomic<uint64_t>> best(vertices, mr);
+    while (!edges.empty()) {
+        parallelBlocks(vertices, blocks, threads, [&](size_t, size_t lo, size_t hi) {
+            for (size_t v = lo; v < hi; ++v) best[v].store(none, std::memory_order_relaxed);
+        });
+        parallelBlocks(edges.size(), blocks, threads, [&](size_t, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                const WEdge& e = edges[i];
+                uint64_t k = uint64_t(static_cast<uint32_t>(e.w) ^ 0x80000000u) << 32 | i;// signed weight order, then index
+                for (int end : {e.u, e.v}) {
+                    uint64_t cur = best[end].load(std::memory_order_relaxed);
+                    while (k < cur && !best[end].compare_exchange_weak(cur, k, std::memory_order_relaxed)) {}
+                }
+            }
+        });
+
+        // Edge ends are component roots, so best[] holds one pick per component
+        for (size_t v = 0; v < vertices; ++v) {
+            uint64_t k = best[v].load(std::memory_order_relaxed);
+            if (k == none) continue;
+            size_t i = static_cast<uint32_t>(k);
+            const WEdge& e = edges[i];
+            if (dsu.unite(e.u, e.v)) {// two components picking the same edge add it once
+                total += e.w;
+                if (forest) forest->edges.push_back({ends[i].first, ends[i].second, e.w});
+            }
+        }
+        relabel();
+
+        const size_t used = std::max<size_t>(1, std::min(blocks, edges.size()));
+        parallelBlocks(edges.size(), used, threads, [&](size_t b, size_t lo, size_t hi) {
+            size_t c = 0;
+            for (size_t i = lo; i < hi; ++i) c += comp[edges[i].u] != comp[edges[i].v];
+            counts[b + 1] = c;
+        });
+        for (size_t b = 0; b < used; ++b) counts[b + 1] += counts[b];
+        kept.resize(counts[used]);
+        keptEnds.resize(forest ? counts[used] : 0);
+        parallelBlocks(edges.size(), used, threads, [&](size_t b, size_t lo, size_t hi) {
+            size_t at = counts[b];
+            for (size_t i = lo; i < hi; ++i) {
+                const WEdge& e = edges[i];
+                if (comp[e.u] != comp[e.v]) {
+                    if (forest) keptEnds[at] = ends[i];
+                    kept[at++] = {comp[e.u], comp[e.v], e.w};
+                }
+            }
+        });
+        edges.swap(kept);
+        ends.swap(keptEnds);
+    }
+    if (forest) labelComponents(dsu, *forest, mr);
+    return total;
+}
+
+/**
  * Kruskal's algorithm for finding the minimum spanning tree (MST) of a graph
  */
-long long mst_weight_kruskal(const graph::Graph& G){
+long long kruskal(const graph::Graph& G, MstForest* forest, std::pmr::memory_resource* mr){
     const int n = G.get_num_of_vertex();
-    auto edges = G.get_edges(); 
 
-    std::vector<std::tuple<int,int,int>> E(edges.begin(), edges.end());// Convert edges to a vector of tuples (src, dest, weight)
+    Scratch<WEdge> E = edgeArray(G, mr);// (src, dest, weight), each undirected edge once
 
     std::sort(E.begin(), E.end(),
-              [](auto &a, auto &b){ return std::get<2>(a) < std::get<2>(b); });//sort the edges by weight
+              [](auto &a, auto &b){ return a.w < b.w; });//sort the edges by weight
 
-    DSU dsu(n);// Disjoint Set Union (DSU) for Kruskal's algorithm
+    DSU dsu(n, mr);// Disjoint Set Union (DSU) for Kruskal's algorithm
     long long total = 0;
     int used = 0;
     for (auto &e : E) {// Iterate over the edges
-        int u,v,w; 
-        std::tie(u,v,w)=e;// Extract the edge information
-        if (dsu.unite(u,v)) {
-            total += w; ++used; if (used == n-1) break;
+        if (dsu.unite(e.u,e.v)) {
+            if (forest) forest->edges.push_back({e.u, e.v, e.w});
+            total += e.w; ++used; if (used == n-1) break;
         }
     }
+    if (forest) labelComponents(dsu, *forest, mr);
     // If the graph is not connected, there is no "true" MST; return the sum of the minimum spanning forest
     return total;
 }
+
+long long runStrategy(const graph::Graph& G, MstStrategy strategy, unsigned threads, MstStrategy* used, MstForest* forest) {
+    if (strategy == MstStrategy::Auto) strategy = choose_mst_strategy(G, threads);
+    if (used) *used = strategy;
+    std::pmr::memory_resource* mr = graph::scratch();
+    switch (strategy) {
+    case MstStrategy::Prim: return prim(G, forest, mr);
+    case MstStrategy::Boruvka: return boruvka(G, graph::resolveThreads(threads), forest, mr);
+    case MstStrategy::FilterKruskal: {
+        Scratch<WEdge> edges = edgeArray(G, mr);
+        FilterKruskal fk(G.get_num_of_vertex(), forest, mr);
+        fk.run(edges.data(), edges.data() + edges.size());
+        if (forest) fk.label(*forest, mr);
+        return fk.total;
+    }
+    default: return kruskal(G, forest, mr);
+    }
+}
+
+}
+
+long long mst_weight_kruskal(const graph::Graph& G){
+    return kruskal(G, nullptr, graph::scratch());
+}
+
+/**
+ * @brief Picks the MST strategy for a graph: Prim when the edges cover a large share of
+ * the vertex pairs, Boruvka for big graphs when enough workers are available, and
+ * Filter-Kruskal otherwise.
+ * @param G The graph.
+ * @param threads Number of workers; 0 uses std::thread::hardware_concurrency().
+ */
+MstStrategy choose_mst_strategy(const graph::Graph& G, unsigned threads) {
+    double n = G.get_num_of_vertex();
+    double m = static_cast<double>(G.get_num_of_arcs()) / 2;
+    if (n >= 2 && m >= PRIM_MIN_DENSITY * n * (n - 1) / 2) return MstStrategy::Prim;
+    if (graph::resolveThreads(threads) >= BORUVKA_MIN_THREADS && m >= static_cast<double>(BORUVKA_MIN_EDGES)) {
+        return MstStrategy::Boruvka;
+    }
+    return MstStrategy::FilterKruskal;
+}
+
+const char* mst_strategy_name(MstStrategy strategy) {
+    switch (strategy) {
+    case MstStrategy::Auto: return "auto";
+    case MstStrategy::Kruskal: return "kruskal";
+    case MstStrategy::FilterKruskal: return "filter-kruskal";
+    case MstStrategy::Boruvka: return "boruvka";
+    case MstStrategy::Prim: return "prim";
+    }
+    return "?";
+}
+
+/**
+ * @brief Weight of a minimum spanning forest.
+ * @param G The graph.
+ * @param strategy The algorithm; Auto asks choose_mst_strategy().
+ * @param threads Workers for Boruvka; 0 uses std::thread::hardware_concurrency().
+ * @param used Optional output: the strategy that ran.
+ * @return The sum of the forest's edge weights.
+ */
+long long compute_mst_weight(const graph::Graph& G, MstStrategy strategy, unsigned threads, MstStrategy* used) {
+    return runStrategy(G, strategy, threads, used, nullptr);
+}
+
+/**
+ * @brief Minimum spanning forest with its edges and component labels, recorded by the
+ * strategy as it goes rather than recomputed afterwards.
+ * @param G The graph.
+ * @param forest Output; its vectors keep their memory resource.
+ * @param strategy The algorithm; Auto asks choose_mst_strategy().
+ * @param threads Workers for Boruvka; 0 uses std::thread::hardware_concurrency().
+ * @param used Optional output: the strategy that ran.
+ */
+void compute_mst_forest(const graph::Graph& G, MstForest& forest, MstStrategy strategy, unsigned threads, MstStrategy* used) {
+    forest.edges.clear();
+    forest.edges.reserve(static_cast<size_t>(std::max(0, G.get_num_of_vertex() - 1)));
+    forest.weight = runStrategy(G, strategy, threads, used, &forest);
+}
@@ -1,83 +1,321 @@
 #include "algorithms/MaxClique.hpp"
+#include "Arena.hpp"
+#include "Parallel.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 
 namespace graph {
 
+namespace {
+
+using Word = uint64_t;
+
+// Temporaries come from the worker's scratch arena (see Arena.hpp)
+template<typename T>
+using Scratch = std::pmr::vector<T>;
+using AdjLists = Scratch<Scratch<int>>;
+
 /**
- * @brief Checks if two vertices are neighbors in the graph.
- * @param G The graph
- * @param u The first vertex.
- * @param v The second vertex
- * @return true if u and v are neighbors, false otherwise.
+ * @brief Orders the vertices by repeatedly removing one of minimum remaining degree
+ * (Matula-Beck bucket queue, O(n + m)).
+ * @param adj Simple adjacency lists.
+ * @return The degeneracy order.
  */
-static bool isNeighbor(const Graph& G, int u, int v) {
-    for (auto [nbr, w] : G.neighbors(u)) {
-        if (nbr == v) return true;
+Scratch<int> degeneracyOrder(const AdjLists& adj) {
+    std::pmr::memory_resource* mr = scratch();
+    int n = static_cast<int>(adj.size());
+    int maxDeg = 0;
+    Scratch<int> deg(n, mr);
+    for (int v = 0; v < n; ++v) {
+        deg[v] = static_cast<int>(adj[v].size());
+        maxDeg = std::max(maxDeg, deg[v]);
+    }
+
+    AdjLists bucket(maxDeg + 1, mr);
+    for (int v = 0; v < n; ++v) bucket[deg[v]].push_back(v);
+
+    Scratch<char> removed(n, 0, mr);
+    Scratch<int> order(mr);
+    order.reserve(n);
+    int d = 0;
+    while (static_cast<int>(order.size()) < n) {
+        d = std::max(d - 1, 0);
+        while (bucket[d].empty()) ++d;
+        int v = bucket[d].back();
+        bucket[d].pop_back();
+        if (removed[v] || deg[v] != d) continue;// stale entry
+        removed[v] = 1;
+        order.push_back(v);
+        for (int w : adj[v]) {
+            if (!removed[w]) bucket[--deg[w]].push_back(w);
+        }
     }
-    return false;
+    return order;
 }
 
+// Best clique found so far, shared by all workers; the size is read lock-free for pruning
+struct SharedBest {
+    std::atomic<size_t> size{0};
+    std::atomic<bool> stop{false};// the cancel token fired: every worker gives up
+    std::mutex m;
+    std::vector<int> members;
+
+    // Records start + cand[local...] if it is still larger than the best clique
+    void offer(int start, const Scratch<int>& cand, const Scratch<int>& local) {
+        std::lock_guard<std::mutex> lk(m);
+        if (local.size() + 1 <= size.load(std::memory_order_relaxed)) return;
+        members.assign(1, start);
+        for (int i : local) members.push_back(cand[i]);
+        size.store(members.size(), std::memory_order_relaxed);
+    }
+};
+
 /**
- * @brief Implements the Bron-Kerbosch algorithm for finding maximal cliques.
- * @param G The graph
- * @param R The current clique
- * @param P The candidates for the next vertex to add to the clique.
- * @param X The vertices that have already been considered.
- * @param bestClique The best clique found so far
+ * Top-level tasks (start vertices, in degeneracy order) dealt round-robin into one deque per worker.
+ * A worker pops from the front of its own deque and, once empty, steals from the back
+ * of the others.
  */
-static void bronKerbosch(const Graph& G,
-                         std::vector<int> R,
-                         std::vector<int> P,
-                         std::vector<int> X,
-                         std::vector<int>& bestClique) {
-    if (P.empty() && X.empty()) {// Base case: no more candidates or excluded vertices
-        if (R.size() > bestClique.size()) {// Found a new best clique
-            bestClique = R;
+class StealingQueues {
+    struct Slot {
+        std::mutex m;
+        std::deque<int> tasks;
+    };
+    std::vector<Slot> slots;
+
+public:
+    StealingQueues(int workers, const Scratch<int>& tasks) : slots(workers) {
+        for (size_t i = 0; i < tasks.size(); ++i) slots[i % workers].tasks.push_back(tasks[i]);
+    }
+
+    bool next(int self, int& task) {
+        {
+            std::lock_guard<std::mutex> lk(slots[self].m);
+            if (!slots[self].tasks.empty()) {
+                task = slots[self].tasks.front();
+                slots[self].tasks.pop_front();
+                return true;
+            }
         }
-        return;
+        int w = static_cast<int>(slots.size());
+        for (int k = 1; k < w; ++k) {
+            Slot& victim = slots[(self + k) % w];
+            std::lock_guard<std::mutex> lk(victim.m);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
     }
+};
 
-    int u = -1;// Pivot
-    if (!P.empty()) u = P[0];// Choose a pivot from P
-    else if (!X.empty()) u = X[0];// or from X
+/**
+ * Bron-Kerbosch with Tomita pivoting on one degeneracy subproblem. The p candidate
+ * vertices (later neighbours of the start vertex) are renumbered 0..p-1 and P, X and
+ * the adjacency rows are bitsets over that range, so every set operation is a loop
+ * over p/64 words. A greedy colouring of P bounds the clique that can still be built.
+ * All the sets live in one pool allocated up front, so the recursion allocates nothing.
+ */
+class CliqueSearch {
+    const int p, words;
+    Scratch<Word> rows;// rows[i*words ..] = neighbours of local vertex i
+    Scratch<Word> pool;// P, X and the branch set for every recursion depth, then two colouring sets
+    Scratch<int> R;
+    const int start;
+    const Scratch<int>& cand;
+    SharedBest& best;
+    CancelPoll& poll;// the worker's, shared by all its searches
 
-    std::vector<int> PwithoutNeighbors;//vector that contains all candidates not connected to the pivot
-    for (int v : P) {//go over the candidates and check if they are connected to the pivot
-        if (u == -1 || !isNeighbor(G, u, v)) {
-            PwithoutNeighbors.push_back(v);
+    size_t bestSize() const { return best.size.load(std::memory_order_relaxed); }
+
+    const Word* row(int i) const { return rows.data() + size_t(i) * words; }
+    Word* P(int depth) { return pool.data() + size_t(depth) * 3 * words; }
+    Word* X(int depth) { return P(depth) + words; }
+    Word* branchSet(int depth) { return P(depth) + 2 * words; }
+    Word* colouring() { return P(p + 2); }// uncoloured, then the current colour class
+
+    static int popcount(const Word* a, int words) {
+        int c = 0;
+        for (int i = 0; i < words; ++i) c += __builtin_popcountll(a[i]);
+        return c;
+    }
+
+    // Number of colours used by a greedy colouring of P: an upper bound on any clique in P
+    int colourBound(const Word* Pset) {
+        Word* uncoloured = colouring();
+        Word* cls = uncoloured + words;
+        std::copy(Pset, Pset + words, uncoloured);
+        int colours = 0;
+        while (popcount(uncoloured, words)) {
+            ++colours;
+            std::copy(uncoloured, uncoloured + words, cls);
+            for (int wi = 0; wi < words; ++wi) {
+                while (cls[wi]) {
+                    int v = wi * 64 + __builtin_ctzll(cls[wi]);
+                    uncoloured[wi] &= ~(Word(1) << (v & 63));
+                    const Word* nv = row(v);
+                    for (int k = 0; k < words; ++k) cls[k] &= ~nv[k];// same colour: no neighbours of v
+                    cls[wi] &= ~(Word(1) << (v & 63));
+                }
+            }
         }
+        return colours;
     }
 
-    for (int v : PwithoutNeighbors) {//go over the candidates not connected to the pivot
-        std::vector<int> Rnext = R;//vector that contains the current clique plus the new vertex
-        Rnext.push_back(v);//insert new vertex into the current clique
+    void expand(int depth) {
+        if (poll()) best.stop.store(true, std::memory_order_relaxed);
+        if (best.stop.load(std::memory_order_relaxed)) return;
+        Word* Pd = P(depth);
+        Word* Xd = X(depth);
+        int pSize = popcount(Pd, words);
+        if (pSize == 0) {
+            if (R.size() + 1 > bestSize()) best.offer(start, cand, R);// +1 for the start vertex
+            return;
+        }
+        if (R.size() + 1 + pSize <= bestSize()) return;
+        if (R.size() + 1 + static_cast<size_t>(colourBound(Pd)) <= bestSize()) return;
 
-        std::vector<int> Pnext, Xnext;
-        for (auto [w, _] : G.neighbors(v)) {//go over the neighbors of the new vertex
-            if (std::find(P.begin(), P.end(), w) != P.end())//if w is in P
-                Pnext.push_back(w);
-            if (std::find(X.begin(), X.end(), w) != X.end())//if w is in X
-                Xnext.push_back(w);
+        // Tomita pivot: u in P u X maximising |P n N(u)|
+        int pivot = -1, pivotHits = -1;
+        for (const Word* S : {static_cast<const Word*>(Pd), static_cast<const Word*>(Xd)}) {
+            for (int wi = 0; wi < words; ++wi) {
+                for (Word b = S[wi]; b; b &= b - 1) {
+                    int u = wi * 64 + __builtin_ctzll(b);
+                    const Word* nu = row(u);
+                    int hits = 0;
+                    for (int k = 0; k < words; ++k) hits += __builtin_popcountll(Pd[k] & nu[k]);
+                    if (hits > pivotHits) { pivotHits = hits; pivot = u; }
+                }
+            }
         }
 
-        bronKerbosch(G, Rnext, Pnext, Xnext, bestClique);// Recursive call
+        Word* branch = branchSet(depth);
+        const Word* np = row(pivot);
+        for (int k = 0; k < words; ++k) branch[k] = Pd[k] & ~np[k];
 
-        P.erase(std::remove(P.begin(), P.end(), v), P.end());// Remove v from P
-        X.push_back(v);// Add v to X
+        Word* Pn = P(depth + 1);
+        Word* Xn = X(depth + 1);
+        for (int wi = 0; wi < words; ++wi) {
+            for (Word b = branch[wi]; b; b &= b - 1) {
+                int v = wi * 64 + __builtin_ctzll(b);
+                const Word* nv = row(v);
+                for (int k = 0; k < words; ++k) {
+                    Pn[k] = Pd[k] & nv[k];
+                    Xn[k] = Xd[k] & nv[k];
+                }
+                R.push_back(v);
+                expand(depth + 1);
+                R.pop_back();
+                if (best.stop.load(std::memory_order_relaxed)) return;
+
+                Pd[wi] &= ~(Word(1) << (v & 63));// move v from P to X
+                Xd[wi] |= Word(1) << (v & 63);
+                if (R.size() + 1 + popcount(Pd, words) <= bestSize()) return;
+            }
+        }
+    }
+
+public:
+    CliqueSearch(const Graph& G, int start, const Scratch<int>& cand, SharedBest& best, CancelPoll& poll,
+                 std::pmr::memory_resource* mr)
+        : p(static_cast<int>(cand.size())), words((p + 63) / 64), rows(size_t(p) * words, 0, mr),
+          pool((size_t(p + 2) * 3 + 2) * words, 0, mr), R(mr), start(start), cand(cand), best(best), poll(poll) {
+        for (int i = 0; i < p; ++i) {
+            for (int j = i + 1; j < p; ++j) {
+                if (G.has_edge(cand[i], cand[j])) {
+                    rows[size_t(i) * words + (j >> 6)] |= Word(1) << (j & 63);
+                    rows[size_t(j) * words + (i >> 6)] |= Word(1) << (i & 63);
+                }
+            }
+        }
     }
+
+    void run() {
+        Word* P0 = P(0);
+        for (int i = 0; i < p; ++i) P0[i >> 6] |= Word(1) << (i & 63);
+        expand(0);
+    }
+};
+
 }
 
 /**
  * @brief Finds the maximum clique in a graph.
+ * Vertices are taken in degeneracy order; each one is searched together with its later
+ * neighbours only (at most the degeneracy many), so every clique is found exactly from
+ * its earliest vertex and hub-heavy graphs stay tractable. The per-vertex searches are
+ * independent and run on work-stealing workers that prune against one shared bound.
  * @param G The graph
- * @return A vector containing the vertices of the maximum clique.
+ * @param threads Number of workers; 0 uses std::thread::hardware_concurrency().
+ * @param cancel Optional: polled by the workers, which all give up once it fires.
+ * @param stopped Optional output: whether the search gave up (the result is then only the best clique so far).
+ * @return A vector containing the vertices of the maximum clique, in ascending order.
  */
-std::vector<int> find_max_clique(const Graph& G) {
+std::vector<int> find_max_clique(const Graph& G, unsigned threads, const CancelToken* cancel, bool* stopped) {
     int n = G.get_num_of_vertex();
-    std::vector<int> R, P(n), X, best;
-    for (int i = 0; i < n; i++) P[i] = i;//define P
-    bronKerbosch(G, R, P, X, best);// Call the Bron-Kerbosch algorithm
-    return best;
+    if (n <= 0) return {};
+
+    std::pmr::memory_resource* mr = scratch();
+    AdjLists adj(n, mr);// simple adjacency: no self-loops or parallel edges
+    for (int u = 0; u < n; ++u) {
+        for (const auto& e : G.neighbors(u)) {
+            if (e.dest != u) adj[u].push_back(e.dest);
+        }
+        std::sort(adj[u].begin(), adj[u].end());
+        adj[u].erase(std::unique(adj[u].begin(), adj[u].end()), adj[u].end());
+    }
+
+    Scratch<int> order = degeneracyOrder(adj);
+    Scratch<int> pos(n, mr);
+    for (int i = 0; i < n; ++i) pos[order[i]] = i;
+
+    SharedBest best;
+    best.members.assign(1, order[0]);
+    best.size.store(1);
+
+    // Vertices without later neighbours can't beat the single-vertex clique
+    Scratch<int> tasks(mr);
+    for (int v : order) {
+        size_t later = 0;
+        for (int w : adj[v]) later += pos[w] > pos[v];
+        if (later >= 1) tasks.push_back(v);
+    }
+
+    auto searchFrom = [&](int v, CancelPoll& poll) {
+        ScratchScope scope;// the search's sets, on this worker's arena until v is done
+        Scratch<int> cand(scratch());// later neighbours of v
+        for (int w : adj[v]) {
+            if (pos[w] > pos[v]) cand.push_back(w);
+        }
+        if (cand.size() + 1 <= best.size.load(std::memory_order_relaxed)) return;
+        CliqueSearch(G, v, cand, best, poll, scratch()).run();
+    };
+
+    threads = std::min<unsigned>(resolveThreads(threads), static_cast<unsigned>(tasks.size() / PARALLEL_MIN_TASKS_PER_WORKER));
+
+    if (threads <= 1) {
+        CancelPoll poll(cancel);
+        for (int v : tasks) {
+            if (best.stop.load(std::memory_order_relaxed)) break;
+            searchFrom(v, poll);
+        }
+    } else {
+        StealingQueues queues(static_cast<int>(threads), tasks);
+        parallelFor(threads, threads, [&](size_t t) {// one queue per worker
+            CancelPoll poll(cancel);
+            int v;
+            while (!best.stop.load(std::memory_order_relaxed) && queues.next(static_cast<int>(t), v)) searchFrom(v, poll);
+        });
+    }
+
+    if (stopped) *stopped = best.stop.load();
+    std::vector<int> result = best.members;
+    std::sort(result.begin(), result.end());
+    return result;
 }
 
 }
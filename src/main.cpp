@@ -18,8 +18,12 @@
 #include <csignal> // for signal handling
 #include <chrono>
 #include <string>
+#include <unistd.h> // for getopt
 
 #include <Pipeline.hpp>
+#include <Reactor.hpp>
+#include <Metrics.hpp>
+#include <memory>
 
 static const int PORT = 5555;
 static const int BACKLOG = 16;
@@ -59,10 +63,155 @@ void handleTerminalInput() {
     }
 }
 
-int main() {
+// Prints the command line options
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [-w workers] [-s STAGE=workers]... [-a max_workers] [-j threads] [-f]\n"
+              << "       [-q capacity] [-p block|reject|shed] [-c cache_bytes] [-t ms] [-b STAGE=ms]...\n"
+              << "       [-S fifo|sjf] [-O overtakes] [-i io_threads | -T]\n"
+              << "  -w  workers started for every pipeline stage (default 1)\n"
+              << "  -s  workers for one stage: MST, MAXFLOW, HAMILTON or MAXCLIQUE\n"
+              << "  -a  let a stage grow up to max_workers when its queue backs up\n"
+              << "  -j  threads one algorithm run may use (default: the cores divided by\n"
+              << "      the stage's most workers)\n"
+              << "  -f  fan-out mode: run the four algorithms of a job in parallel\n"
+              << "  -q  bound every pipeline queue to capacity jobs (default unbounded)\n"
+              << "  -p  when the pipeline is full: block the client, reject with ERR BUSY,\n"
+              << "      or shed the oldest queued job (default block)\n"
+              << "  -c  result cache size in bytes, 0 disables it (default 32 MiB)\n"
+              << "  -t  deadline for every job in milliseconds; requests may ask for less\n"
+              << "  -b  run time budget of one stage per job, e.g. HAMILTON=2000 (MAXFLOW, HAMILTON, MAXCLIQUE)\n"
+              << "  -S  order of the jobs waiting for a stage: arrival, or the smallest\n"
+              << "      estimated cost first (default sjf)\n"
+              << "  -O  under sjf, how many cheaper jobs may pass a queued job before it\n"
+              << "      goes first (default 16)\n"
+              << "  -i  epoll event-loop threads serving the clients (default 2)\n"
+              << "  -T  legacy mode: one thread per client connection\n";
+}
+
+// How the server talks to its clients
+struct ServerOptions {
+    unsigned ioThreads = 2;// reactors, each with its own SO_REUSEPORT listening socket
+    bool threadPerConnection = false;
+};
+
+// Parses the command line into the pipeline configuration; returns false on bad input
+static bool parseArgs(int argc, char* argv[], graph::PipelineConfig& cfg, ServerOptions& srv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "w:s:a:j:fq:p:c:t:b:S:O:i:T")) != -1) {
+        try {
+            if (opt == 'w') {
+                cfg.workersPerStage = static_cast<unsigned>(std::stoul(optarg));
+            }
+            else if (opt == 's') {
+                std::string arg = optarg;
+                size_t eq = arg.find('=');
+                if (eq == std::string::npos) return false;
+                std::string stage = arg.substr(0, eq);
+                if (stage != "MST" && stage != "MAXFLOW" && stage != "HAMILTON" && stage != "MAXCLIQUE") return false;
+                cfg.stageWorkers[stage] = static_cast<unsigned>(std::stoul(arg.substr(eq + 1)));
+            }
+            else if (opt == 'a') {
+                cfg.maxWorkersPerStage = static_cast<unsigned>(std::stoul(optarg));
+            }
+            else if (opt == 'j') {
+                cfg.innerThreads = static_cast<unsigned>(std::stoul(optarg));
+            }
+            else if (opt == 'f') {
+                cfg.fanOut = true;
+            }
+            else if (opt == 'q') {
+                cfg.queueCapacity = std::stoul(optarg);
+            }
+            else if (opt == 'p') {
+                std::string policy = optarg;
+                if (policy == "block") cfg.admission = graph::AdmissionPolicy::Block;
+                else if (policy == "reject") cfg.admission = graph::AdmissionPolicy::Reject;
+                else if (policy == "shed") cfg.admission = graph::AdmissionPolicy::ShedOldest;
+                else return false;
+            }
+            else if (opt == 'c') {
+                cfg.cacheBytes = std::stoul(optarg);
+            }
+            else if (opt == 't') {
+                cfg.jobTimeout = std::chrono::milliseconds(std::stoul(optarg));
+            }
+            else if (opt == 'b') {
+                std::string arg = optarg;
+                size_t eq = arg.find('=');
+                if (eq == std::string::npos) return false;
+                std::string stage = arg.substr(0, eq);
+                auto alg = graph::AlgorithmFactory::create(stage);
+                if (!alg || !alg->cancellable()) return false;// a budget it cannot stop for would only be ignored
+                cfg.stageBudgets[stage] = std::chrono::milliseconds(std::stoul(arg.substr(eq + 1)));
+            }
+            else if (opt == 'S') {
+                std::string order = optarg;
+                if (order == "fifo") cfg.scheduling = graph::Scheduling::Fifo;
+                else if (order == "sjf") cfg.scheduling = graph::Scheduling::ShortestFirst;
+                else return false;
+            }
+            else if (opt == 'O') {
+                cfg.maxOvertakes = std::stoul(optarg);
+            }
+            else if (opt == 'i') {
+                srv.ioThreads = static_cast<unsigned>(std::stoul(optarg));
+                if (srv.ioThreads == 0) return false;
+            }
+            else if (opt == 'T') {
+                srv.threadPerConnection = true;
+            }
+            else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return optind == argc;
+}
+
+// Serves the clients from a fixed set of epoll reactors instead of a thread per connection
+static int runEventLoop(unsigned ioThreads) {
+    std::vector<std::unique_ptr<graph::Reactor>> reactors;
+    for (unsigned i = 0; i < ioThreads; ++i) {
+        reactors.push_back(std::make_unique<graph::Reactor>());
+        if (!reactors.back()->open(PORT, BACKLOG)) return 1;
+    }
+
+    std::cerr << "Server listening on port " << PORT << " (" << ioThreads << " event-loop threads) ...\n";
+    std::cout << "Type 'exit' to shutdown gracefully, or use Ctrl+C" << std::endl;
+
+    std::thread input_thread(handleTerminalInput);
+
+    std::vector<std::thread> io;
+    for (auto& r : reactors) {
+        io.emplace_back([&r]() { r->run(server_running); });
+    }
+
+    for (auto& t : io) t.join();
+    std::cout << "Shutting down server..." << std::endl;
+    if (input_thread.joinable()) input_thread.join();
+
+    std::cout << "Server shutdown complete." << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    graph::PipelineConfig cfg;
+    ServerOptions srv;
+    if (!parseArgs(argc, argv, cfg, srv)) {
+        usage(argv[0]);
+        return 1;
+    }
+    graph::ThreadPool::configure(cfg);
+
     // Set up signal handlers for graceful shutdown
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
+
+    if (!srv.threadPerConnection) {
+        return runEventLoop(srv.ioThreads);
+    }
     
     int sfd = ::socket(AF_INET, SOCK_STREAM, 0);// Create a socket for the server(ipv4, TCP)
     if (sfd < 0) { perror("socket"); return 1; }
@@ -115,9 +264,11 @@ int main() {
         }
         
         // Create thread to handle client
+        graph::Metrics::instance().connectionOpened();
         threads.emplace_back([cfd]() {
             handleClient(cfd);
             close(cfd);
+            graph::Metrics::instance().connectionClosed();
         });
     }
 
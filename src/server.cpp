@@ -2,10 +2,12 @@
 #include "AlgorithmFactory.hpp"// Include the AlgorithmFactory header
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include <cerrno>// For errno
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <sstream>
@@ -14,9 +16,8 @@
 #include "server.hpp"
 #include <thread>//for thread using
 
-//for generate random graph
-#include <random>
-#include <unordered_set>
+#include <string_view>
+#include "RequestParser.hpp"
 
 //for part 9 pipeline
 #include "Pipeline.hpp"
@@ -61,6 +62,113 @@ bool writeAll(int fd, const std::string &s) {
     return true;
 }
 
+/**
+ * @brief Parses one complete request.
+ * GRAPH and RANDOM requests become a pipeline job for the frozen graph; everything
+ * answered right away (DEPTH, parse errors) comes back as a reply instead.
+ * @param req The full request text.
+ * @param job Set to the new job when the function returns true.
+ * @param reply Set to the immediate response when the function returns false.
+ * @return true if job is ready to be pushed into the pipeline.
+ */
+bool parseRequest(std::string_view req, graph::JobPtr& job, std::string& reply) {
+    graph::RequestParser parser;
+    parser.feed(req);
+    return parser.finish(job, reply);
+}
+
+/*
+    * Framed protocol: a connection that starts with FRAMED_HELLO carries any number of
+    * requests, each sent as "REQ <tag> <length>\n" followed by exactly length bytes.
+    * Every response comes back as "RES <tag> <length>\n" plus the body, tagged with the
+    * request's tag because pipelined responses may arrive out of order.
+*/
+const std::string FRAMED_HELLO = "FRAMED\n";
+
+// Checks whether buf could still turn out to be the framed greeting
+bool couldBeFramed(const std::string &buf) {
+    size_t n = std::min(buf.size(), FRAMED_HELLO.size());
+    return buf.compare(0, n, FRAMED_HELLO, 0, n) == 0;
+}
+
+/**
+ * @brief Takes the next complete request frame from buf, starting at pos.
+ * @param buf Bytes received so far.
+ * @param pos Start of the next frame; moved past it when one is returned.
+ * @param tag Set to the frame's tag.
+ * @param payload Set to the request text (a view into buf).
+ * @return Frame if one was taken, NeedMore if it is incomplete, Bad on a malformed header.
+ */
+FrameStatus takeFrame(const std::string &buf, size_t &pos, std::string &tag, std::string_view &payload) {
+    size_t eol = buf.find('\n', pos);
+    if (eol == std::string::npos) {
+        return buf.size() - pos > MAX_FRAME_HEADER ? FrameStatus::Bad : FrameStatus::NeedMore;
+    }
+    std::istringstream header(buf.substr(pos, eol - pos));
+    std::string word, extra;
+    long long length;
+    if (!(header >> word >> tag >> length) || word != "REQ" || header >> extra ||
+        length < 0 || static_cast<unsigned long long>(length) > MAX_FRAME_BYTES) {
+        return FrameStatus::Bad;
+    }
+    size_t body = eol + 1;
+    if (buf.size() - body < static_cast<size_t>(length)) return FrameStatus::NeedMore;
+    payload = std::string_view(buf).substr(body, static_cast<size_t>(length));
+    pos = body + static_cast<size_t>(length);
+    return FrameStatus::Frame;
+}
+
+// Wraps one response for the framed protocol
+std::string encodeFrame(const std::string &tag, const std::string &body) {
+    return "RES " + tag + " " + std::to_string(body.size()) + "\n" + body;
+}
+
+// Runs a parsed job through the pipeline and waits for its response; cancels it if the client hangs up
+static std::string runJob(int cfd, const graph::JobPtr &job) {
+    // Keep our own reference: with a fast pipeline the sink may release its copy
+    // before this thread gets to wait on the job
+    if (!graph::getThreadPool().pushJob(job)) {
+        return "ERR BUSY\n";// refused by the admission policy, the client may retry
+    }
+    std::unique_lock<std::mutex> lk(job->job_mutex);
+    while (!job->cv.wait_for(lk, std::chrono::milliseconds(200), [&job]{ return job->completed.load(); })) {
+        pollfd pfd{cfd, 0, 0};// POLLHUP and POLLERR are always reported
+        if (!job->cancelled.load() && ::poll(&pfd, 1, 0) > 0) {
+            lk.unlock();
+            graph::getThreadPool().cancelJob(job);
+            lk.lock();
+        }
+    }
+    return job->result;// copy the response while still holding the lock
+}
+
+// Serves a framed connection one request at a time; buf holds what followed the greeting
+static void serveFramed(int cfd, std::string buf) {
+    size_t pos = 0;
+    char chunk[4096];
+    while (true) {
+        std::string tag;
+        std::string_view req;
+        FrameStatus st = takeFrame(buf, pos, tag, req);
+        if (st == FrameStatus::Bad) {
+            writeAll(cfd, encodeFrame("-", "ERR PARSE_FAILED: bad frame header\n"));
+            return;
+        }
+        if (st == FrameStatus::Frame) {
+            graph::JobPtr job;
+            std::string reply;
+            if (parseRequest(req, job, reply)) reply = runJob(cfd, job);
+            if (!writeAll(cfd, encodeFrame(tag, reply))) return;
+            continue;
+        }
+        buf.erase(0, pos);
+        pos = 0;
+        ssize_t n = ::read(cfd, chunk, sizeof(chunk));
+        if (n <= 0) return;// client closed the connection (or it failed)
+        buf.append(chunk, chunk + n);
+    }
+}
+
 /**
  * @brief Handles a client connection
  * Reads the graph from the client, checks for an Eulerian cycle,
@@ -76,141 +184,40 @@ void handleClient(int cfd) {
     std::this_thread::sleep_for(std::chrono::seconds(5));
     */
 
-    try {
-        std::string req;
-        if (!readAllText(cfd, req)) {
+    // Read until we know whether the client speaks the framed protocol
+    std::string head;
+    char chunk[4096];
+    while (head.size() < FRAMED_HELLO.size() && couldBeFramed(head)) {
+        ssize_t n = ::read(cfd, chunk, sizeof(chunk));
+        if (n < 0) {
             writeAll(cfd, "ERR READ_FAILED\n");
             return;
         }
-
-    int V , E;//vertex and edges
-    std::istringstream in(req);
-    std::string tag;//
-
-    //for part 8 b
-    if (!(in >> tag)) {
-        writeAll(cfd, "ERR PARSE_FAILED: missing request type\n");
-        return;
-    }
-
-    bool randomGraph = false;
-
-    //conditions to identify graph type read its description and check for specific properties and correctness
-    if (tag == "GRAPH") {
-        //if the client requested a specific graph and continue to read its description
+        if (n == 0) break;
+        head.append(chunk, chunk + n);
     }
-
-    else if (tag == "RANDOM") {//if the client requested a random graph
-        randomGraph = true;
-    }
-
-    else {
-        writeAll(cfd, "ERR PARSE_FAILED: expected 'GRAPH' or 'RANDOM'\n");
+    if (head.size() >= FRAMED_HELLO.size() && couldBeFramed(head)) {
+        serveFramed(cfd, head.substr(FRAMED_HELLO.size()));
         return;
     }
 
-    if (!(in >> tag) || tag != "V") {
-        writeAll(cfd, "ERR PARSE_FAILED: expected 'V <num_vertices>'\n");
-        return;
+    // Plain request: parse the chunks as they arrive, up to the client's half-close
+    graph::RequestParser parser;
+    parser.feed(head);
+    ssize_t n;
+    while ((n = ::read(cfd, chunk, sizeof(chunk))) > 0) {
+        parser.feed(std::string_view(chunk, static_cast<size_t>(n)));
     }
-    if (!(in >> V) || V <= 0) {
-        writeAll(cfd, "ERR PARSE_FAILED: invalid vertex count\n");
+    if (n < 0) {
+        writeAll(cfd, "ERR READ_FAILED\n");
         return;
     }
 
-    if (!(in >> tag) || tag != "E") {
-        writeAll(cfd, "ERR PARSE_FAILED: expected 'E <num_edges>'\n");
-        return;
-    }
-    if (!(in >> E) || E < 0) {
-        writeAll(cfd, "ERR PARSE_FAILED: invalid edge count\n");
+    graph::JobPtr job_shared;
+    std::string reply;
+    if (!parser.finish(job_shared, reply)) {
+        writeAll(cfd, reply);
         return;
     }
-
-  
-    Graph G(V);// Create a graph with the specified number of vertices
-    //bool withWeight = (algo == "MST" || algo == "MAXFLOW");
-
-    if(randomGraph){
-        std::random_device rd;
-        std::mt19937 gen(rd());// Create random number generator
-        std::uniform_int_distribution<> dist(0, V-1);// Create uniform distribution for vertex selection in range [0, V-1]
-
-        std::unordered_set<long long> used; // to prevent duplicates
-        std::uniform_int_distribution<> wdist(1, 10);//range of random weights
-
-        for (int i = 0; i < E; ++i) {
-            int u, v;
-            long long key;
-            do {
-                u = dist(gen);
-                v = dist(gen);
-                key = (static_cast<long long>(u) << 32) | v;
-            } while (u == v || used.count(key)); // without self-loops and duplicates
-
-            used.insert(key);
-            G.addEdge(u, v, wdist(gen)); // random weight
-        }
-    }
-    else{
-        for (int i = 0; i < E; ++i) {
-            int u, v, w = 1;
-            if (!(in >> u >> v)) {
-                writeAll(cfd, "ERR PARSE_FAILED: invalid edge line format\n");
-                return;
-            }
-            if (in.peek() != '\n' && in >> w) {
-                //if there is a weight, read it
-            }
-            
-            // Check for negative weights
-            if (w < 0) {
-                writeAll(cfd, "ERR PARSE_FAILED: negative edge weights are not allowed\n");
-                return;
-            }
-            
-            // Check for vertex index validity
-            if (u < 0 || u >= V || v < 0 || v >= V) {
-                writeAll(cfd, "ERR PARSE_FAILED: vertex index out of range\n");
-                return;
-            }
-            
-            G.addEdge(u, v, w);
-        }
-    }
-
-// For Pipeline 
-    // Create shared_ptr directly without intermediate copy
-    auto job_shared = std::make_shared<graph::Job>();
-    job_shared->g = std::make_shared<Graph>(std::move(G));
-
-    // Store weak_ptr to avoid circular dependencies and race conditions
-    std::weak_ptr<graph::Job> job_weak = job_shared;
-
-    graph::getThreadPool().pushJob(std::move(job_shared));
-
-    // Use weak_ptr to get access only when needed
-    if (auto job_ptr = job_weak.lock()) {
-        std::unique_lock<std::mutex> lk(job_ptr->job_mutex);
-        job_ptr->cv.wait(lk, [&job_ptr]{ return job_ptr->completed.load(); });
-        
-        // Get response while still holding the lock
-        std::string response = job_ptr->result;
-        lk.unlock();
-        
-        writeAll(cfd, response);//send response back to client
-    } else {
-        writeAll(cfd, "ERR JOB_LOST\n");
-    }
-
-    } catch (const std::invalid_argument& e) {
-        writeAll(cfd, "ERR INVALID_ARGUMENT: " + std::string(e.what()) + "\n");
-    } catch (const std::out_of_range& e) {
-        writeAll(cfd, "ERR OUT_OF_RANGE: " + std::string(e.what()) + "\n");
-    } catch (const std::exception& e) {
-        writeAll(cfd, "ERR EXCEPTION: " + std::string(e.what()) + "\n");
-    }
-
+    writeAll(cfd, runJob(cfd, job_shared));//send response back to client
 }
-
-
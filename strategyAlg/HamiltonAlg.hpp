@@ -1,17 +1,40 @@
 #pragma once
 #include "Algorithm.hpp"
 #include "algorithms/Hamilton.hpp"
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <thread>
 #include <chrono>
 #include <iostream>
+#include <mutex>
 
 namespace graph {
+    extern std::mutex cout_mutex;// defined in Pipeline.cpp
 
 struct HamiltonAlgorithm : Algorithm {
     std::string run(const Graph& G) override {
+        return run(G, AlgorithmParams(), CancelToken());
+    }
+
+    std::string run(const Graph& G, const AlgorithmParams&, const CancelToken& cancel) override {
 
-        auto cycle = find_hamiltonian_cycle(G); //func is implement in Graph.cpp
+        HamiltonStats stats;
+        auto cycle = find_hamiltonian_cycle(G, &stats, &cancel); //func is implement in Hamilton.cpp
+        stopped = stats.stopped;
+        {
+            std::lock_guard<std::mutex> lk(cout_mutex);
+            std::cerr << "[HAMILTON] strategy " << stats.strategy
+                      << " expanded " << stats.nodes << " nodes"
+                      << (stats.stopped ? " (stopped)" : "") << std::endl;
+        }
+        if (stats.stopped) {
+            if (cancel.cancelled()) return "ERR CANCELLED HAMILTON\n";
+            std::ostringstream out;
+            out << "ERR TIMEOUT HAMILTON (best-so-far path of " << stats.longestPath << "/"
+                << G.get_num_of_vertex() << " vertices)\n";
+            return out.str();
+        }
         if (cycle.empty()) return "ERR NO HAMILTONIAN CYCLE\n";
         std::ostringstream out;
         out << "OK"<<" HAM VERTEX:";
@@ -20,6 +43,15 @@ struct HamiltonAlgorithm : Algorithm {
         return out.str();
 
     }
+
+    bool cancellable() const override { return true; }
+
+    // Held-Karp is V^2 2^V; branch and bound above its limit is exponential too, so big
+    // graphs rank behind every small one
+    double cost(const Graph& G, const AlgorithmParams&) const override {
+        int n = G.get_num_of_vertex();
+        return std::ldexp(static_cast<double>(n) * n, std::min(n, 64));
+    }
 };
 
 }
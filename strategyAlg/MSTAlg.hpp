@@ -1,19 +1,73 @@
 #pragma once
 #include "Algorithm.hpp"
-#include <sstream>
+#include "Arena.hpp"
+#include "algorithms/MST.hpp"
+#include <charconv>
+#include <cmath>
 #include <thread>
 #include <chrono>
 #include <iostream>
+#include <mutex>
 
 namespace graph {
+    extern std::mutex cout_mutex;// defined in Pipeline.cpp
 
 struct MSTAlgorithm : Algorithm {
     std::string run(const Graph& G) override {
+        return run(G, AlgorithmParams(), CancelToken());
+    }
+
+    // MST EDGES / MST COMPONENTS: the forest after its weight, numbers written straight into the reply
+    std::string run(const Graph& G, const AlgorithmParams& params, const CancelToken&) override {
+
+        MstStrategy used = MstStrategy::Auto;
+        MstForest forest(scratch());
+        if (params.mstEdges || params.mstComponents) compute_mst_forest(G, forest, MstStrategy::Auto, threads, &used);
+        else forest.weight = compute_mst_weight(G, MstStrategy::Auto, threads, &used);   // func is implement in MST.cpp
+        {
+            std::lock_guard<std::mutex> lk(cout_mutex);
+            std::cerr << "[MST] strategy " << mst_strategy_name(used) << std::endl;
+        }
+
+        std::string out;
+        out.reserve(64 + (params.mstEdges ? forest.edges.size() * 3 * 12 : 0) + (params.mstComponents ? forest.component.size() * 12 : 0));
+        out += "OK MST WEIGHT:";
+        appendField(out, forest.weight);
+        out += '\n';
+        if (params.mstEdges) {
+            out += "OK MST EDGES:";
+            for (const MstEdge& e : forest.edges) {
+                appendField(out, e.u);
+                appendField(out, e.v);
+                appendField(out, e.weight);
+            }
+            out += '\n';
+        }
+        if (params.mstComponents) {
+            out += "OK MST COMPONENTS";
+            appendField(out, forest.components);
+            out += ':';
+            for (int c : forest.component) appendField(out, c);
+            out += '\n';
+        }
+        return out;
+    }
+
+    // Prim on dense graphs: m plus a heap operation per vertex; Filter-Kruskal (and
+    // Boruvka, split over the workers): about m plus a sort of the n-1 lightest edges
+    double cost(const Graph& G, const AlgorithmParams&) const override {
+        double n = G.get_num_of_vertex();
+        double m = static_cast<double>(G.get_num_of_arcs()) / 2;
+        return m + n * std::log2(n + 2) * (choose_mst_strategy(G, threads) == MstStrategy::Prim ? 1 : std::log2(m / (n + 1) + 2));
+    }
 
-        long long w = G.mst_weight();   // func is implement in Graph.cpp
-        std::ostringstream out;
-        out << "OK MST WEIGHT: " << w << "\n";
-        return out.str();
+private:
+    // " <x>" appended in place, without a stream
+    static void appendField(std::string& out, long long x) {
+        char buf[24];
+        buf[0] = ' ';
+        char* end = std::to_chars(buf + 1, buf + sizeof(buf), x).ptr;
+        out.append(buf, end);
     }
 };
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "Algorithm.hpp"
 #include "algorithms/MaxClique.hpp"
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <thread>
 #include <chrono>
@@ -11,8 +13,21 @@ namespace graph {
 struct MaxCliqueAlgorithm : Algorithm {
     // implement the run method
     std::string run(const Graph& G) override {
+        return run(G, AlgorithmParams(), CancelToken());
+    }
+
+    std::string run(const Graph& G, const AlgorithmParams&, const CancelToken& cancel) override {
 
-        auto clique = find_max_clique(G);
+        stopped = false;
+        auto clique = find_max_clique(G, threads, &cancel, &stopped);
+        if (stopped) {
+            if (cancel.cancelled()) return "ERR CANCELLED MAXCLIQUE\n";
+            std::ostringstream out;
+            out << "ERR TIMEOUT MAXCLIQUE (best-so-far clique of size " << clique.size() << ":";
+            for (auto v : clique) out << " " << v;
+            out << ")\n";
+            return out.str();
+        }
         if (clique.empty()) return "ERR NO CLIQUE\n";
 
         std::ostringstream out;//for output
@@ -22,6 +37,19 @@ struct MaxCliqueAlgorithm : Algorithm {
         out << "\n";
         return out.str();
     }
+
+    bool cancellable() const override { return true; }
+
+    // The search tree grows like 2^w for the clique number w, estimated as for a random
+    // graph of the same density: 2 log V / log(1/p)
+    double cost(const Graph& G, const AlgorithmParams&) const override {
+        double n = G.get_num_of_vertex();
+        double arcs = static_cast<double>(G.get_num_of_arcs());
+        if (n < 2) return n + arcs;
+        double p = std::min(1.0, arcs / (n * (n - 1)));
+        double w = p >= 1.0 ? n : 2 * std::log(n) / std::log(1 / std::max(p, 1e-9));
+        return (n + arcs) * std::exp2(std::min(w, 64.0));
+    }
 };
 
 }
@@ -1,5 +1,8 @@
 #pragma once
 #include "Algorithm.hpp"
+#include "algorithms/GomoryHu.hpp"
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <thread>
 #include <chrono>
@@ -9,12 +12,54 @@ namespace graph {
 
 struct MaxFlowAlgorithm : Algorithm {
     std::string run(const Graph& G) override {
-        
-        int flow = G.max_flow(0, G.get_num_of_vertex() - 1); // func is implement in Graph.cpp
+        stopped = false;// a single max flow runs to the end
+        long long flow = G.max_flow(0, G.get_num_of_vertex() - 1); // func is implement in Graph.cpp
         std::ostringstream out;
         out << "OK MAX FLOW " << flow << "\n";
         return out.str();
     }
+
+    // FLOW s t ...: one line per pair; FLOW ALL: the min cut tree as (vertex, parent, weight) triples.
+    // These take many max flows, and cancel is polled before each one
+    std::string run(const Graph& G, const AlgorithmParams& params, const CancelToken& cancel) override {
+        std::ostringstream out;
+        stopped = false;
+        if (params.flowAllPairs) {
+            GomoryHuTree tree = gomory_hu_tree(G, threads, &cancel, &stopped);
+            if (stopped) return stoppedReply(cancel);
+            out << "OK MIN CUT TREE:";
+            for (int v = 1; v < G.get_num_of_vertex(); ++v) {
+                out << " " << v << " " << tree.parent[v] << " " << tree.weight[v];
+            }
+            out << "\n";
+            return out.str();
+        }
+        if (params.flowPairs.empty()) return run(G);
+
+        std::vector<long long> flows = max_flows(G, params.flowPairs, threads, &cancel, &stopped);
+        if (stopped) return stoppedReply(cancel);
+        for (size_t i = 0; i < flows.size(); ++i) {
+            out << "OK MAX FLOW " << params.flowPairs[i].first << " " << params.flowPairs[i].second
+                << " " << flows[i] << "\n";
+        }
+        return out.str();
+    }
+
+    bool cancellable() const override { return true; }
+
+    // About E * sqrt(V) per max flow in practice; FLOW ALL and long FLOW lists need V - 1 of them
+    double cost(const Graph& G, const AlgorithmParams& params) const override {
+        double n = G.get_num_of_vertex();
+        double flows = 1;
+        if (params.flowAllPairs) flows = std::max(1.0, n - 1);
+        else if (!params.flowPairs.empty()) flows = std::min<double>(params.flowPairs.size(), std::max(1.0, n - 1));
+        return flows * (static_cast<double>(G.get_num_of_arcs()) * std::sqrt(n) + n);
+    }
+
+private:
+    static std::string stoppedReply(const CancelToken& cancel) {
+        return cancel.cancelled() ? "ERR CANCELLED MAXFLOW\n" : "ERR TIMEOUT MAXFLOW\n";
+    }
 };
 
 }
@@ -0,0 +1,58 @@
+// reishaul1@gmail.com
+/**
+ * Compares the adjacency-list layout of graph::Graph with its frozen CSR form:
+ * heap footprint and the time of a full neighbour traversal.
+ * Usage: ./bench_csr [V] [E] [rounds]
+ */
+#include "Graph.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+// Walks every adjacency once per round and sums the weights (keeps the loop alive)
+long long traverse(const graph::Graph& G, int rounds, double& ms) {
+    long long sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int v = 0; v < G.get_num_of_vertex(); ++v) {
+            for (const auto& e : G.neighbors(v)) sum += e.weight + e.dest;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return sum;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int V = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int E = argc > 2 ? std::atoi(argv[2]) : 1000000;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    graph::Graph G(V);
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> dist(0, V - 1);
+    std::uniform_int_distribution<> wdist(1, 10);
+    for (int i = 0; i < E; ++i) G.addEdge(dist(gen), dist(gen), wdist(gen));
+
+    double adj_ms = 0, csr_ms = 0;
+    size_t adj_bytes = G.memory_bytes();
+    long long adj_sum = traverse(G, rounds, adj_ms);
+
+    G.freeze();
+    size_t csr_bytes = G.memory_bytes();
+    long long csr_sum = traverse(G, rounds, csr_ms);
+
+    std::cout << "V=" << V << " E=" << E << " rounds=" << rounds << "\n";
+    std::cout << "adjacency list: " << adj_bytes << " bytes, " << adj_ms << " ms\n";
+    std::cout << "CSR:            " << csr_bytes << " bytes, " << csr_ms << " ms\n";
+    if (adj_sum != csr_sum) {
+        std::cerr << "checksum mismatch: " << adj_sum << " vs " << csr_sum << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+// reishaul1@gmail.com
+/**
+ * Client-side throughput check against a running server: sends N small random graphs
+ * once with a fresh connection per graph (plain protocol) and once pipelined over a
+ * single framed connection, and reports graphs per second for both.
+ * Usage: ./bench_framed [graphs] [vertices] [port]
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+int connectTo(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        std::exit(1);
+    }
+    return fd;
+}
+
+void sendAll(int fd, const std::string& s) {
+    size_t sent = 0;
+    while (sent < s.size()) {
+        ssize_t n = ::write(fd, s.data() + sent, s.size() - sent);
+        if (n <= 0) { perror("write"); std::exit(1); }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+std::string randomGraph(int n, std::mt19937& gen) {
+    std::uniform_int_distribution<> vd(0, n - 1), wd(1, 9);
+    std::set<std::pair<int, int>> edges;
+    while (static_cast<int>(edges.size()) < 2 * n) {
+        int u = vd(gen), v = vd(gen);
+        if (u != v) edges.insert({std::min(u, v), std::max(u, v)});
+    }
+    std::ostringstream out;
+    out << "GRAPH V " << n << " E " << edges.size() << "\n";
+    for (const auto& [u, v] : edges) out << u << " " << v << " " << wd(gen) << "\n";
+    return out.str();
+}
+
+// One connection per graph, half-close after the request
+double plain(const std::vector<std::string>& graphs, int port) {
+    auto start = std::chrono::steady_clock::now();
+    char buf[4096];
+    for (const auto& g : graphs) {
+        int fd = connectTo(port);
+        sendAll(fd, g);
+        shutdown(fd, SHUT_WR);
+        while (::read(fd, buf, sizeof(buf)) > 0) {}
+        close(fd);
+    }
+    return graphs.size() / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Everything pipelined over one framed connection; a reader thread counts the responses
+double framed(const std::vector<std::string>& graphs, int port) {
+    auto start = std::chrono::steady_clock::now();
+    int fd = connectTo(port);
+
+    std::thread reader([&] {
+        std::string in;
+        char buf[65536];
+        size_t responses = 0, pos = 0;
+        while (responses < graphs.size()) {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0) { std::cerr << "connection closed early\n"; std::exit(1); }
+            in.append(buf, buf + n);
+            while (true) {// "RES <tag> <length>\n" + body
+                size_t eol = in.find('\n', pos);
+                if (eol == std::string::npos) break;
+                size_t sp = in.rfind(' ', eol);
+                size_t len = std::stoul(in.substr(sp + 1, eol - sp - 1));
+                if (in.size() - eol - 1 < len) break;
+                pos = eol + 1 + len;
+                ++responses;
+            }
+            in.erase(0, pos);
+            pos = 0;
+        }
+    });
+
+    sendAll(fd, "FRAMED\n");
+    for (size_t i = 0; i < graphs.size(); ++i) {
+        sendAll(fd, "REQ " + std::to_string(i) + " " + std::to_string(graphs[i].size()) + "\n" + graphs[i]);
+    }
+    reader.join();
+    close(fd);
+    return graphs.size() / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int vertices = argc > 2 ? std::atoi(argv[2]) : 10;
+    int port = argc > 3 ? std::atoi(argv[3]) : 5555;
+
+    std::mt19937 gen(42);
+    std::vector<std::string> graphs;
+    for (int i = 0; i < count; ++i) graphs.push_back(randomGraph(vertices, gen));
+
+    std::cout << count << " graphs, V=" << vertices << "\n";
+    std::cout << "  connection per graph  " << plain(graphs, port) << " graphs/s\n";
+    std::cout << "  framed, one connection " << framed(graphs, port) << " graphs/s\n";
+    return 0;
+}
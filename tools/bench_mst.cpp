@@ -0,0 +1,46 @@
+// reishaul1@gmail.com
+/**
+ * Times every MST strategy on one random graph and checks that they agree on the weight.
+ * Usage: ./bench_mst [V] [E] [threads]
+ */
+#include "Arena.hpp"
+#include "Graph.hpp"
+#include "RandomGraph.hpp"
+#include "algorithms/MST.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    int V = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    long long E = argc > 2 ? std::atoll(argv[2]) : 4000000;
+    unsigned threads = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 0;
+
+    graph::RandomGraphSpec spec;
+    spec.vertices = V;
+    spec.edges = E;
+    spec.seed = 12345;
+    if (const char* bad = graph::validateRandomSpec(spec)) {
+        std::cerr << bad << std::endl;
+        return 1;
+    }
+    graph::Graph G(V);
+    graph::generateRandomGraph(G, spec);
+
+    std::cout << "V=" << V << " E=" << E << " auto picks "
+              << mst_strategy_name(choose_mst_strategy(G, threads)) << "\n";
+    long long expected = -1;
+    for (MstStrategy s : {MstStrategy::Kruskal, MstStrategy::FilterKruskal, MstStrategy::Boruvka, MstStrategy::Prim}) {
+        graph::ScratchScope scope;// as in a pipeline stage
+        auto start = std::chrono::steady_clock::now();
+        long long w = compute_mst_weight(G, s, threads);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << mst_strategy_name(s) << ": weight " << w << ", " << ms << " ms\n";
+        if (expected >= 0 && w != expected) {
+            std::cerr << "weight mismatch: " << w << " vs " << expected << std::endl;
+            return 1;
+        }
+        expected = w;
+    }
+    return 0;
+}
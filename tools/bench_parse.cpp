@@ -0,0 +1,96 @@
+// reishaul1@gmail.com
+/**
+ * Request parsing throughput: the old path (whole request in a std::string, read with
+ * std::istringstream and operator>>) against RequestParser fed 64 KB receive-sized
+ * chunks, for the text request and its BGRAPH raw / varint encodings. All of them
+ * build and freeze the same graph.
+ * Usage: ./bench_parse [V] [E] [rounds]
+ * Build the library objects optimized too, or the parser runs at -O0:
+ *   make clean && make CXXFLAGS="-std=c++17 -O2" tools
+ */
+#include "BinaryGraph.hpp"
+#include "RequestParser.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// The parsing loop handleClient used before RequestParser, errors reduced to a flag
+bool streamParse(const std::string& req) {
+    std::istringstream in(req);
+    std::string tag;
+    int V, E;
+    if (!(in >> tag) || tag != "GRAPH") return false;
+    if (!(in >> tag) || tag != "V" || !(in >> V) || V <= 0) return false;
+    if (!(in >> tag) || tag != "E" || !(in >> E) || E < 0) return false;
+    graph::Graph G(V);
+    for (int i = 0; i < E; ++i) {
+        int u, v, w = 1;
+        if (!(in >> u >> v)) return false;
+        if (in.peek() != '\n' && in >> w) {
+            //if there is a weight, read it
+        }
+        if (w < 0 || u < 0 || u >= V || v < 0 || v >= V) return false;
+        G.addEdge(u, v, w);
+    }
+    G.freeze();
+    return true;
+}
+
+bool chunkParse(const std::string& req) {
+    constexpr size_t CHUNK = 64 * 1024;
+    graph::RequestParser parser;
+    std::string_view all(req);
+    for (size_t pos = 0; pos < all.size(); pos += CHUNK) parser.feed(all.substr(pos, CHUNK));
+    graph::JobPtr job;
+    std::string reply;
+    return parser.finish(job, reply);
+}
+
+// Prints request size, time per request and MB/s
+template<typename F>
+void report(const char* name, F parse, const std::string& req, int rounds) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        if (!parse(req)) {
+            std::cerr << "parse failed\n";
+            std::exit(1);
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  " << name << "  " << req.size() / 1e6 << " MB  " << secs * 1000 / rounds
+              << " ms/request  " << req.size() * double(rounds) / secs / 1e6 << " MB/s\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    int V = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int E = argc > 2 ? std::atoi(argv[2]) : 1000000;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 3;
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> vd(0, V - 1), wd(1, 100);
+    std::string req = "GRAPH V " + std::to_string(V) + " E " + std::to_string(E) + "\n";
+    std::vector<graph::bgraph::Edge> edges;
+    for (int i = 0; i < E; ++i) {
+        int u = vd(gen), v = vd(gen), w = wd(gen);
+        req += std::to_string(u) + " " + std::to_string(v) + " " + std::to_string(w) + "\n";
+        edges.push_back({static_cast<uint32_t>(u), static_cast<uint32_t>(v), w});
+    }
+    std::string raw = graph::bgraph::encode(V, edges, graph::bgraph::RAW);
+    std::string packed = graph::bgraph::encode(V, edges, graph::bgraph::VARINT);
+
+    std::cout << "request V=" << V << " E=" << E << "\n";
+    report("text, istringstream ", streamParse, req, rounds);
+    report("text, RequestParser ", chunkParse, req, rounds);
+    report("BGRAPH raw          ", chunkParse, raw, rounds);
+    report("BGRAPH varint       ", chunkParse, packed, rounds);
+    return 0;
+}
@@ -0,0 +1,64 @@
+// reishaul1@gmail.com
+/**
+ * Microbenchmark of the two pipeline queues under contention: P producers and C
+ * consumers move N items each way through BlockingQueue and MPMCQueue.
+ * Usage: ./bench_queue [producers] [consumers] [items_per_producer]
+ */
+#include "Pipeline.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Runs one round and returns the throughput in million items per second
+template<typename Queue>
+double run(Queue& q, int producers, int consumers, long items) {
+    std::atomic<long long> checksum{0};
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            long long local = 0;
+            while (auto item = q.pop()) local += *item;// empty pointer: closed and drained
+            checksum += local;
+        });
+    }
+    std::vector<std::thread> senders;
+    for (int p = 0; p < producers; ++p) {
+        senders.emplace_back([&] {
+            auto one = std::make_shared<int>(1);
+            for (long i = 0; i < items; ++i) q.push(one);
+        });
+    }
+    for (auto& t : senders) t.join();
+    q.close();
+    for (auto& t : threads) t.join();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (checksum != static_cast<long long>(producers) * items) {
+        std::cerr << "lost items: " << checksum << std::endl;
+        std::exit(1);
+    }
+    return producers * items / secs / 1e6;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int producers = argc > 1 ? std::atoi(argv[1]) : 4;
+    int consumers = argc > 2 ? std::atoi(argv[2]) : 4;
+    long items = argc > 3 ? std::atol(argv[3]) : 200000;
+
+    graph::BlockingQueue<std::shared_ptr<int>> locked;
+    graph::MPMCQueue<std::shared_ptr<int>> lockfree(1024);
+
+    std::cout << producers << " producers, " << consumers << " consumers, "
+              << items << " items each\n";
+    std::cout << "BlockingQueue (mutex):   " << run(locked, producers, consumers, items) << " Mitems/s\n";
+    std::cout << "MPMCQueue (lock-free):   " << run(lockfree, producers, consumers, items) << " Mitems/s\n";
+    return 0;
+}
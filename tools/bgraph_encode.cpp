@@ -0,0 +1,63 @@
+// reishaul1@gmail.com
+/**
+ * Converts a text GRAPH request into the binary BGRAPH format for upload.
+ * Usage: ./bgraph_encode [-z] [input.txt] > graph.bin
+ *   -z  sorted delta/varint records instead of raw 12-byte records
+ * Reads stdin when no input file is given; the sizes go to stderr.
+ */
+#include "BinaryGraph.hpp"
+#include "RequestParser.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    bool varint = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-z") == 0) varint = true;
+        else path = argv[i];
+    }
+
+    std::ifstream file;
+    if (path) {
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "cannot open " << path << "\n";
+            return 1;
+        }
+    }
+    std::istream& in = path ? file : std::cin;
+
+    // Same validation as the server: parse the text request with RequestParser
+    graph::RequestParser parser;
+    size_t textBytes = 0;
+    char buf[1 << 16];
+    while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+        parser.feed(std::string_view(buf, static_cast<size_t>(in.gcount())));
+        textBytes += static_cast<size_t>(in.gcount());
+    }
+    graph::JobPtr job;
+    std::string reply;
+    if (!parser.finish(job, reply)) {
+        std::cerr << reply;
+        return 1;
+    }
+
+    const graph::Graph& G = *job->g;
+    std::vector<graph::bgraph::Edge> edges;
+    for (int u = 0; u < G.get_num_of_vertex(); ++u) {
+        for (const auto& e : G.neighbors(u)) {
+            if (e.dest >= u) {// every undirected edge once (self-loops are stored once)
+                edges.push_back({static_cast<uint32_t>(u), static_cast<uint32_t>(e.dest), e.weight});
+            }
+        }
+    }
+
+    std::string out = graph::bgraph::encode(static_cast<uint32_t>(G.get_num_of_vertex()), std::move(edges),
+                                            varint ? graph::bgraph::VARINT : graph::bgraph::RAW);
+    std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+    std::cerr << "text " << textBytes << " bytes -> BGRAPH " << out.size() << " bytes\n";
+    return 0;
+}